@@ -8,6 +8,7 @@
 #include "mednafen/state_helpers.h"
 #include "mednafen/masmem.h"
 #include "mednafen/settings.h"
+#include "mednafen/state_rewind.h"
 
 /* Forward declarations */
 void MDFN_LoadGameCheats(void *override);
@@ -25,6 +26,57 @@ static retro_input_state_t input_state_cb;
 
 static bool libretro_supports_bitmasks = false;
 
+#define FRAMESKIP_MAX 30
+
+static unsigned frameskip_type             = 0;
+static unsigned frameskip_threshold        = 0;
+static unsigned frameskip_counter          = 0;
+static unsigned frameskip_total            = 0;
+static unsigned frames_total               = 0;
+
+static bool retro_audio_buff_active        = false;
+static unsigned retro_audio_buff_occupancy = 0;
+static bool retro_audio_buff_underrun      = false;
+
+static unsigned audio_latency              = 0;
+static bool update_audio_latency           = false;
+
+/* While the frontend fast-forwards, only one in this many frames is
+ * converted and uploaded, and audio synthesis is dropped (0 = off) */
+static unsigned fastforward_interval       = 0;
+static unsigned fastforward_counter        = 0;
+
+/* Audio slices per frame: samples are also handed to the frontend at
+ * VIP display region boundaries (1 = only at the end of the frame) */
+static unsigned audio_slices               = 1;
+static int16_t *audio_slice_buf            = NULL;
+static int32 audio_slice_buf_size          = 0;
+
+/* Output sample rate in Hz, or 0 for the VSU's native rate */
+static unsigned audio_sample_rate          = 44100;
+static bool audio_sample_rate_changed      = false;
+
+/* In-core rewind: depth in seconds (0 = off), whether the history is
+ * being played backwards, the playback option as last read, and the
+ * time spent capturing since the ring was set up */
+static unsigned rewind_seconds             = 0;
+static bool rewind_changed                 = false;
+static bool rewind_reverse                 = false;
+static bool rewind_playback_reverse        = false;
+static retro_time_t rewind_capture_usec    = 0;
+
+/* Native run-ahead: hidden frames emulated past the real one (0 = off),
+ * and the raw snapshot buffer used to come back from them */
+static unsigned run_ahead_frames           = 0;
+static uint8_t *run_ahead_buf              = NULL;
+static uint32_t run_ahead_size             = 0;
+
+/* Cached retro_serialize_size(); 0 until computed for the loaded game */
+static size_t serialize_size;
+
+/* Compressed save states, zero-padded to retro_serialize_size() */
+static bool state_compression              = false;
+
 static bool overscan;
 static struct MDFN_PixelFormat last_pixel_format;
 
@@ -96,10 +148,12 @@ static const uint32 AnaglyphPreset_Colors[][2] =
 #define RIGHT_DPAD_UP_DOWN (RIGHT_DPAD_UP | RIGHT_DPAD_DOWN)
 
 static bool opposite_directions = false;
+static bool input_late_latch = false;
+static bool input_polled = false;
 
 static uint32 VB3DMode;
 
-static Blip_Buffer sbuf[2];
+static Blip_StereoBuffer sbuf;
 
 static uint8 *WRAM = NULL;
 
@@ -109,6 +163,15 @@ static uint32 GPRAM_Mask;
 static uint8 *GPROM = NULL;
 static uint32 GPROM_Mask;
 
+bool VB_DirtyTracking = false;
+uint32 VB_DirtyBits[VB_DIRTY_PAGES / 32];
+static uint32 DirtyFrame[VB_DIRTY_PAGES / 32];
+
+/* Dirty pages summed per region over dirty_frames frames, for the
+ * statistics logged on unload */
+static uint64_t dirty_pages_total[4];
+static unsigned dirty_frames;
+
 V810 *VB_V810 = NULL;
 
 static uint32 VSU_CycleFix;
@@ -265,10 +328,16 @@ void MDFN_FASTCALL MemWrite8(v810_timestamp_t &timestamp, uint32 A, uint8 V)
          break;
       case 5:
          WRAM[A & 0xFFFF] = V;
+         if(VB_DirtyTracking)
+            VB_MarkDirty(VB_DIRTY_WRAM_BASE, A & 0xFFFF);
          break;
       case 6:
          if(GPRAM)
+         {
             GPRAM[A & GPRAM_Mask] = V;
+            if(VB_DirtyTracking)
+               VB_MarkDirty(VB_DIRTY_GPRAM_BASE, A & GPRAM_Mask);
+         }
          break;
 
       case 7:
@@ -296,10 +365,16 @@ void MDFN_FASTCALL MemWrite16(v810_timestamp_t &timestamp, uint32 A, uint16 V)
          break;
       case 5:
          StoreU16_LE((uint16 *)&WRAM[A & 0xFFFF], V);
+         if(VB_DirtyTracking)
+            VB_MarkDirty(VB_DIRTY_WRAM_BASE, A & 0xFFFF);
          break;
       case 6:
          if(GPRAM)
+         {
             StoreU16_LE((uint16 *)&GPRAM[A & GPRAM_Mask], V);
+            if(VB_DirtyTracking)
+               VB_MarkDirty(VB_DIRTY_GPRAM_BASE, A & GPRAM_Mask);
+         }
          break;
       case 3:
       case 4:
@@ -388,9 +463,31 @@ static void ForceEventUpdates(const v810_timestamp_t timestamp)
    VB_V810->SetEventNT(CalcNextTS());
 }
 
+/* Everything counts as written after a power-on, a state load or a rewind
+ * step.  Internal snapshot restores (MDFNSS_LoadRaw) don't call this;
+ * their callers decide what the restore changed. */
+static void DirtyAll(void)
+{
+   memset(VB_DirtyBits, 0xFF, sizeof(VB_DirtyBits));
+}
+
+extern "C" void VB_SetDirtyTracking(bool enabled)
+{
+   if(enabled && !VB_DirtyTracking)
+      DirtyAll();
+
+   VB_DirtyTracking = enabled;
+}
+
+extern "C" const uint32 *VB_GetDirtyPages(void)
+{
+   return VB_DirtyTracking ? DirtyFrame : NULL;
+}
+
 static void VB_Power(void)
 {
    memset(WRAM, 0, 65536);
+   DirtyAll();
 
    VIP_Power();
    VSU_Power();
@@ -1875,7 +1972,7 @@ static int Load(const uint8_t *data, size_t size)
    memset(GPRAM, 0, GPRAM_Mask + 1);
 
    VIP_Init();
-   VSU_Init(&sbuf[0], &sbuf[1]);
+   VSU_Init(&sbuf);
    VBINPUT_Init();
 
    VB3DMode = MDFN_GetSettingUI("vb.3dmode");
@@ -1907,9 +2004,8 @@ static int Load(const uint8_t *data, size_t size)
 
 static void CloseGame(void)
 {
-#if 0
    VIP_Kill();
-#endif
+   Blip_StereoBuffer_deinit(&sbuf);
 
 #if 0
    if(GPRAM)
@@ -1938,9 +2034,26 @@ extern "C" void VB_ExitLoop(void)
    VB_V810->Exit();
 }
 
+extern "C" void VB_DisplayRegionBoundary(const v810_timestamp_t timestamp, const int region)
+{
+   int32 clocks;
+   int32 frames;
+
+   if (!audio_slice_buf || (region % (4 / audio_slices)))
+      return;
+
+   clocks = VSU_EndSlice((timestamp + VSU_CycleFix) >> 2);
+   Blip_StereoBuffer_end_frame(&sbuf, clocks);
+   frames = Blip_StereoBuffer_read_samples(&sbuf, audio_slice_buf, audio_slice_buf_size);
+
+   if (frames)
+      audio_batch_cb(audio_slice_buf, frames);
+}
+
 static void Emulate(EmulateSpecStruct *espec, int16_t *sound_buf)
 {
    v810_timestamp_t v810_timestamp;
+   int32 vsu_clocks;
 
    MDFNMP_ApplyPeriodicCheats();
 
@@ -1948,21 +2061,25 @@ static void Emulate(EmulateSpecStruct *espec, int16_t *sound_buf)
 
    VIP_StartFrame(espec);
 
+   if (sound_buf && audio_slices > 1)
+   {
+      audio_slice_buf      = sound_buf;
+      audio_slice_buf_size = espec->SoundBufMaxSize;
+   }
+
    v810_timestamp = VB_V810->Run(EventHandler);
 
    FixNonEvents();
    ForceEventUpdates(v810_timestamp);
 
-   VSU_EndFrame((v810_timestamp + VSU_CycleFix) >> 2);
+   audio_slice_buf = NULL;
+
+   vsu_clocks = VSU_EndFrame((v810_timestamp + VSU_CycleFix) >> 2);
 
    if(sound_buf)
    {
-      int y;
-      for(y = 0; y < 2; y++)
-      {
-         Blip_Buffer_end_frame(&sbuf[y], (v810_timestamp + VSU_CycleFix) >> 2);
-         espec->SoundBufSize = Blip_Buffer_read_samples(&sbuf[y], sound_buf + y, espec->SoundBufMaxSize);
-      }
+      Blip_StereoBuffer_end_frame(&sbuf, vsu_clocks);
+      espec->SoundBufSize = Blip_StereoBuffer_read_samples(&sbuf, sound_buf, espec->SoundBufMaxSize);
    }
 
    VSU_CycleFix = (v810_timestamp + VSU_CycleFix) & 3;
@@ -1974,6 +2091,12 @@ static void Emulate(EmulateSpecStruct *espec, int16_t *sound_buf)
    RebaseTS(v810_timestamp);
 
    VB_V810->ResetTS(0);
+
+   if(VB_DirtyTracking)
+   {
+      memcpy(DirtyFrame, VB_DirtyBits, sizeof(DirtyFrame));
+      memset(VB_DirtyBits, 0, sizeof(VB_DirtyBits));
+   }
 }
 
 extern "C" int StateAction(StateMem *sm, int load, int data_only)
@@ -2003,6 +2126,7 @@ extern "C" int StateAction(StateMem *sm, int load, int data_only)
    // Needed to recalculate next_*_ts since we don't bother storing their deltas in save states.
    if(load)
       ForceEventUpdates(timestamp);
+
    return ret;
 }
 
@@ -2024,6 +2148,30 @@ extern "C" int StateAction(StateMem *sm, int load, int data_only)
 
 const char *mednafen_core_str = MEDNAFEN_CORE_NAME;
 
+/* The VSU latches its output every 120 of its clocks */
+#define VSU_NATIVE_DIVIDER 120
+
+static double get_audio_sample_rate(void)
+{
+   if (!audio_sample_rate)
+      return VB_MASTER_CLOCK / 4 / VSU_NATIVE_DIVIDER;
+   return audio_sample_rate;
+}
+
+static void set_audio_sample_rate(void)
+{
+   if (!audio_sample_rate)
+      Blip_StereoBuffer_set_native_rate(&sbuf, (long)(VB_MASTER_CLOCK / 4), VSU_NATIVE_DIVIDER, 50);
+   else
+   {
+      Blip_StereoBuffer_set_sample_rate(&sbuf, audio_sample_rate, 50);
+      Blip_StereoBuffer_set_clock_rate(&sbuf, (long)(VB_MASTER_CLOCK / 4));
+   }
+   Blip_StereoBuffer_bass_freq(&sbuf, 20);
+
+   audio_sample_rate_changed = false;
+}
+
 static void check_system_specs(void)
 {
    unsigned level = 0;
@@ -2077,6 +2225,51 @@ static void set_volume (uint32_t *ptr, unsigned number)
    }
 }
 
+static void retro_audio_buff_status_cb(bool active, unsigned occupancy, bool underrun_likely)
+{
+   retro_audio_buff_active    = active;
+   retro_audio_buff_occupancy = occupancy;
+   retro_audio_buff_underrun  = underrun_likely;
+}
+
+static void init_frameskip(void)
+{
+   if (frameskip_type > 0)
+   {
+      struct retro_audio_buffer_status_callback buf_status_cb;
+
+      buf_status_cb.callback = retro_audio_buff_status_cb;
+      if (!environ_cb(RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK, &buf_status_cb))
+      {
+         if (log_cb)
+            log_cb(RETRO_LOG_WARN, "[%s]: Frameskip disabled - frontend does not support audio buffer status monitoring.\n", mednafen_core_str);
+
+         retro_audio_buff_active    = false;
+         retro_audio_buff_occupancy = 0;
+         retro_audio_buff_underrun  = false;
+         audio_latency              = 0;
+      }
+      else
+      {
+         /* Frameskip is enabled - increase frontend audio latency
+          * to minimise potential buffer underruns */
+         float frame_time_msec = 1000.0f / MEDNAFEN_CORE_TIMING_FPS;
+
+         /* Set latency to 6x current frame time, rounded up
+          * to nearest multiple of 32 */
+         audio_latency = (unsigned)((6.0f * frame_time_msec) + 0.5f);
+         audio_latency = (audio_latency + 0x1F) & ~0x1F;
+      }
+   }
+   else
+   {
+      environ_cb(RETRO_ENVIRONMENT_SET_AUDIO_BUFFER_STATUS_CALLBACK, NULL);
+      audio_latency = 0;
+   }
+
+   update_audio_latency = true;
+}
+
 static void check_variables(void)
 {
    struct retro_variable var = {0};
@@ -2230,6 +2423,14 @@ static void check_variables(void)
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
       opposite_directions = !strcmp(var.value, "enabled");
 
+   var.key = "vb_input_late_latch";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      input_late_latch = !strcmp(var.value, "enabled");
+      VBINPUT_SetLateLatch(input_late_latch);
+   }
+
    var.key = "vb_cpu_emulation";
 
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
@@ -2254,6 +2455,99 @@ static void check_variables(void)
          log_cb(RETRO_LOG_INFO, "[%s]: Side-by-side separation changed: %u pixels.\n", mednafen_core_str, setting_vb_sidebyside_separation);
       }
    }
+
+   var.key = "vb_frameskip";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      unsigned old_frameskip_type = frameskip_type;
+
+      if (strcmp(var.value, "auto") == 0)
+         frameskip_type = 1;
+      else if (strcmp(var.value, "manual") == 0)
+         frameskip_type = 2;
+      else
+         frameskip_type = 0;
+
+      if (old_frameskip_type != frameskip_type)
+         init_frameskip();
+   }
+
+   var.key = "vb_frameskip_threshold";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      frameskip_threshold = strtoul(var.value, NULL, 10);
+
+   var.key = "vb_sample_rate";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      unsigned old_sample_rate = audio_sample_rate;
+
+      if (strcmp(var.value, "native") == 0)
+         audio_sample_rate = 0;
+      else
+         audio_sample_rate = strtoul(var.value, NULL, 10);
+
+      if (old_sample_rate != audio_sample_rate)
+         audio_sample_rate_changed = true;
+   }
+
+   var.key = "vb_audio_slices";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      if (!strcmp(var.value, "per_region"))
+         audio_slices = 4;
+      else if (!strcmp(var.value, "per_eye"))
+         audio_slices = 2;
+      else
+         audio_slices = 1;
+   }
+
+   var.key = "vb_rewind";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      unsigned old_rewind_seconds = rewind_seconds;
+
+      rewind_seconds = strtoul(var.value, NULL, 10);
+      if (rewind_seconds != old_rewind_seconds)
+         rewind_changed = true;
+   }
+
+   var.key = "vb_rewind_playback";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+   {
+      bool reverse = !strcmp(var.value, "reverse");
+
+      /* Only changing the option starts or stops playback; a saved
+       * 'Reverse' is dropped at load (see retro_load_game) */
+      if (reverse != rewind_playback_reverse)
+         rewind_reverse = reverse;
+      rewind_playback_reverse = reverse;
+   }
+
+   var.key = "vb_state_compression";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      state_compression = !strcmp(var.value, "enabled");
+
+   var.key = "vb_run_ahead";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      run_ahead_frames = strtoul(var.value, NULL, 10);
+
+   var.key = "vb_lightweight_fastforward";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      fastforward_interval = strtoul(var.value, NULL, 10);
+
+   var.key = "vb_dirty_tracking";
+
+   if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value)
+      VB_SetDirtyTracking(!strcmp(var.value, "enabled"));
 }
 
 #define MAX_PLAYERS 1
@@ -2309,6 +2603,9 @@ bool retro_load_game(const struct retro_game_info *info)
 
    check_variables();
 
+   serialize_size = 0;
+   MDFNSS_LayoutChanged();
+
    if (Load((const uint8_t*)info->data, info->size) <= 0)
       return false;
 
@@ -2355,21 +2652,70 @@ bool retro_load_game(const struct retro_game_info *info)
 
    check_variables();
 
-   {
-      int y;
-      for(y = 0; y < 2; y++)
-      {
-         Blip_Buffer_set_sample_rate(&sbuf[y], 44100, 50);
-         Blip_Buffer_set_clock_rate(&sbuf[y], (long)(VB_MASTER_CLOCK / 4));
-         Blip_Buffer_bass_freq(&sbuf[y], 20);
-      }
-   }
+   set_audio_sample_rate();
+
+   rewind_changed = true;
+   rewind_reverse = false;
 
    return true;
 }
 
 void retro_unload_game(void)
 {
+   if (log_cb && frameskip_total)
+      log_cb(RETRO_LOG_INFO, "[%s]: Frameskip: %u of %u frames skipped.\n", mednafen_core_str, frameskip_total, frames_total);
+
+   /* Frontend drops the buffer status callback with the game,
+    * force it to be registered again on the next load */
+   frameskip_type             = 0;
+   frameskip_counter          = 0;
+   frameskip_total            = 0;
+   frames_total               = 0;
+   retro_audio_buff_active    = false;
+   retro_audio_buff_occupancy = 0;
+   retro_audio_buff_underrun  = false;
+   audio_latency              = 0;
+   update_audio_latency       = false;
+   fastforward_counter        = 0;
+   serialize_size             = 0;
+   MDFNSS_LayoutChanged();
+
+   if (log_cb && rewind_seconds)
+   {
+      uint64_t captures, stored;
+      uint32_t snap_size;
+
+      MDFNSR_GetStats(&captures, &stored, &snap_size);
+      if (captures > 1)
+         log_cb(RETRO_LOG_INFO, "[%s]: Rewind: %u byte snapshots, %u bytes per frame on average.\n",
+               mednafen_core_str, (unsigned)snap_size, (unsigned)(stored / (captures - 1)));
+      if (captures && perf_cb.get_time_usec)
+         log_cb(RETRO_LOG_INFO, "[%s]: Rewind: %.1f us per capture on average, %.1f ms over %u captures.\n",
+               mednafen_core_str, (double)rewind_capture_usec / captures,
+               (double)rewind_capture_usec / 1000.0, (unsigned)captures);
+   }
+   MDFNSR_Kill();
+   rewind_capture_usec        = 0;
+
+   if (log_cb && dirty_frames)
+   {
+      log_cb(RETRO_LOG_INFO, "[%s]: Dirty pages per frame: WRAM %.1f/256, GPRAM %.1f/%u, DRAM %.1f/512, CHR RAM %.1f/128.\n",
+            mednafen_core_str,
+            (double)dirty_pages_total[0] / dirty_frames,
+            (double)dirty_pages_total[1] / dirty_frames, (GPRAM_Mask + 1) >> VB_DIRTY_PAGE_SHIFT,
+            (double)dirty_pages_total[2] / dirty_frames,
+            (double)dirty_pages_total[3] / dirty_frames);
+   }
+   memset(dirty_pages_total, 0, sizeof(dirty_pages_total));
+   dirty_frames               = 0;
+
+   if (run_ahead_buf)
+      free(run_ahead_buf);
+   run_ahead_buf              = NULL;
+   run_ahead_size             = 0;
+
+   VSU_SetSynthMuted(false);
+
    MDFN_FlushGameCheats(0);
    CloseGame();
    MDFNMP_Kill();
@@ -2464,20 +2810,117 @@ static void update_input(void)
    }
 }
 
-static void update_geometry(unsigned width, unsigned height)
+static void poll_input(void)
+{
+   input_poll_cb();
+
+   update_input();
+
+   input_polled = true;
+}
+
+extern "C" void VB_LatchInput(void)
+{
+   if (!input_polled)
+      poll_input();
+}
+
+static void update_geometry(unsigned width, unsigned height, bool timing_changed)
 {
    struct retro_system_av_info info;
 
    memset(&info, 0, sizeof(info));
    info.timing.fps            = MEDNAFEN_CORE_TIMING_FPS;
-   info.timing.sample_rate    = 44100;
+   info.timing.sample_rate    = get_audio_sample_rate();
    info.geometry.base_width   = width;
    info.geometry.base_height  = height;
    info.geometry.max_width    = MEDNAFEN_CORE_GEOMETRY_MAX_W;
    info.geometry.max_height   = MEDNAFEN_CORE_GEOMETRY_MAX_H;
    info.geometry.aspect_ratio = (float) width / (float) height;
 
-   environ_cb(RETRO_ENVIRONMENT_SET_GEOMETRY, &info);
+   environ_cb(timing_changed ? RETRO_ENVIRONMENT_SET_SYSTEM_AV_INFO : RETRO_ENVIRONMENT_SET_GEOMETRY, &info);
+}
+
+static void count_dirty_pages(void)
+{
+   static const unsigned region_base[5] =
+   {
+      VB_DIRTY_WRAM_BASE, VB_DIRTY_GPRAM_BASE, VB_DIRTY_DRAM_BASE,
+      VB_DIRTY_CHR_RAM_BASE, VB_DIRTY_PAGES
+   };
+   const uint32 *dirty = VB_GetDirtyPages();
+   unsigned region, page;
+
+   if (!dirty)
+      return;
+
+   for (region = 0; region < 4; region++)
+      for (page = region_base[region]; page < region_base[region + 1]; page++)
+         if (dirty[page >> 5] & (1U << (page & 31)))
+            dirty_pages_total[region]++;
+
+   dirty_frames++;
+}
+
+/* Emulate the real frame with audio, rasterised but not converted, then
+ * run_ahead_frames hidden frames on the same input without audio,
+ * presenting the last.  Only the real frame is kept; the raw snapshot
+ * brings the core back, and the dirty page map is put back with it. */
+static void run_ahead(EmulateSpecStruct *spec, int16_t *sound_buf)
+{
+   const bool skip_frame = spec->skip;
+   uint32 dirty_frame[VB_DIRTY_PAGES / 32];
+   uint32 dirty_bits[VB_DIRTY_PAGES / 32];
+   int32 sound_size;
+   unsigned i;
+
+   if (!run_ahead_buf)
+   {
+      run_ahead_size = MDFNSS_RawSize(0);
+      run_ahead_buf  = (uint8_t*)malloc(run_ahead_size);
+   }
+
+   if (!run_ahead_buf)
+   {
+      Emulate(spec, sound_buf);
+      return;
+   }
+
+   spec->skip_convert = true;
+   Emulate(spec, sound_buf);
+   spec->skip_convert = false;
+   sound_size = spec->SoundBufSize;
+
+   /* A full snapshot: the hidden frames draw over the framebuffer the
+    * real timeline shows next, which the game may also read back */
+   MDFNSS_SaveRaw(run_ahead_buf, run_ahead_size, 0);
+
+   if (VB_DirtyTracking)
+   {
+      memcpy(dirty_frame, DirtyFrame, sizeof(dirty_frame));
+      memcpy(dirty_bits, VB_DirtyBits, sizeof(dirty_bits));
+   }
+
+   VSU_SetSynthMuted(true);
+   spec->VideoFormatChanged = false;
+
+   for (i = 0; i < run_ahead_frames; i++)
+   {
+      spec->skip = skip_frame || (i + 1 < run_ahead_frames);
+      Emulate(spec, NULL);
+   }
+
+   VSU_SetSynthMuted(false);
+   MDFNSS_LoadRaw(run_ahead_buf, run_ahead_size);
+
+   if (VB_DirtyTracking)
+   {
+      memcpy(DirtyFrame, dirty_frame, sizeof(dirty_frame));
+      memcpy(VB_DirtyBits, dirty_bits, sizeof(dirty_bits));
+   }
+
+   spec->skip         = skip_frame;
+   spec->SoundBufSize = sound_size;
 }
 
 void retro_run(void)
@@ -2486,10 +2929,9 @@ void retro_run(void)
    EmulateSpecStruct spec;
    static unsigned width   = 0, height = 0;
    bool resolution_changed = false;
-
-   input_poll_cb();
-
-   update_input();
+   bool skip_frame         = false;
+   bool fastforward        = false;
+   bool rewinding          = false;
 
    spec.surface            = &surf;
    spec.VideoFormatChanged = false;
@@ -2497,16 +2939,131 @@ void retro_run(void)
    spec.DisplayRect.y      = 0;
    spec.DisplayRect.w      = 0;
    spec.DisplayRect.h      = 0;
-   spec.SoundBufMaxSize    = sizeof(sound_buf) / 2;
+   spec.SoundBufMaxSize    = sizeof(sound_buf) / (2 * sizeof(sound_buf[0]));
    spec.SoundBufSize       = 0;
 
+   /* Skip rendering if the frontend audio buffer is running dry */
+   if (retro_audio_buff_active)
+   {
+      switch (frameskip_type)
+      {
+         case 1: /* auto */
+            skip_frame = retro_audio_buff_underrun;
+            break;
+         case 2: /* manual */
+            skip_frame = (retro_audio_buff_occupancy < frameskip_threshold);
+            break;
+         default:
+            break;
+      }
+
+      if (!skip_frame || (frameskip_counter >= FRAMESKIP_MAX))
+      {
+         skip_frame        = false;
+         frameskip_counter = 0;
+      }
+      else
+      {
+         frameskip_counter++;
+         frameskip_total++;
+      }
+   }
+
+   /* Fast-forwarding: keep the machine fully emulated, but only
+    * convert every Nth frame and don't synthesize audio */
+   fastforward = false;
+   if (fastforward_interval)
+      environ_cb(RETRO_ENVIRONMENT_GET_FASTFORWARDING, &fastforward);
+
+   if (fastforward)
+   {
+      if (++fastforward_counter < fastforward_interval)
+         skip_frame = true;
+      else
+         fastforward_counter = 0;
+   }
+   else
+      fastforward_counter = 0;
+
+   /* Rewinding: restore the newest capture and run it again silently,
+    * with the input it was recorded with.  Once the history is used up,
+    * play on from there. */
+   rewinding = false;
+   if (rewind_changed)
+   {
+      MDFNSR_Init((unsigned)(rewind_seconds * MEDNAFEN_CORE_TIMING_FPS));
+      rewind_changed      = false;
+      rewind_capture_usec = 0;
+   }
+
+   input_polled = false;
+
+   if (rewind_seconds && rewind_reverse)
+   {
+      uint32_t tag;
+
+      rewinding = MDFNSR_StepBack(&tag);
+      if (rewinding)
+      {
+         DirtyAll();
+
+         input_poll_cb();
+         input_buf[0] = tag & 0xFFFF;
+         low_battery  = tag >> 16;
+         input_polled = true;
+      }
+      else
+         rewind_reverse = false;
+   }
+
+   /* With late latching, input is polled when the game first starts a
+    * pad read this frame (see VB_LatchInput) */
+   if (!input_polled && !input_late_latch)
+      poll_input();
+
+   if (rewind_seconds && !rewinding)
+   {
+      retro_time_t start = perf_cb.get_time_usec ? perf_cb.get_time_usec() : 0;
+
+      MDFNSR_Capture();
+      if (perf_cb.get_time_usec)
+         rewind_capture_usec += perf_cb.get_time_usec() - start;
+   }
+
+   VSU_SetSynthMuted(fastforward || rewinding);
+
+   frames_total++;
+
+   spec.skip               = skip_frame;
+   spec.skip_convert       = false;
+
+   /* If frameskip settings have changed, update
+    * frontend audio latency */
+   if (update_audio_latency)
+   {
+      environ_cb(RETRO_ENVIRONMENT_SET_MINIMUM_AUDIO_LATENCY, &audio_latency);
+      update_audio_latency = false;
+   }
+
    if (memcmp(&last_pixel_format, &spec.surface->format, sizeof(struct MDFN_PixelFormat)))
    {
       spec.VideoFormatChanged = true;
       last_pixel_format       = spec.surface->format;
    }
 
-   Emulate(&spec, sound_buf);
+   if (run_ahead_frames && !fastforward && !rewinding)
+      run_ahead(&spec, sound_buf);
+   else
+      Emulate(&spec, (fastforward || rewinding) ? NULL : sound_buf);
+
+   if (!input_polled)
+      poll_input();
+
+   /* Keep the input this frame ran with, for rewind playback */
+   if (rewind_seconds && !rewinding)
+      MDFNSR_SetTag(input_buf[0] | ((uint32_t)low_battery << 16));
+
+   count_dirty_pages();
 
    if (width != spec.DisplayRect.w || height != spec.DisplayRect.h)
       resolution_changed = true;
@@ -2515,21 +3072,33 @@ void retro_run(void)
    height = spec.DisplayRect.h;
 
 #if defined(WANT_32BPP)
-   const uint32_t *pix = surf.pixels;
+   const uint32_t *pix = skip_frame ? NULL : surf.pixels;
    video_cb(pix, width, height, FB_WIDTH << 2);
 #elif defined(WANT_16BPP)
-   const uint16_t *pix = surf.pixels16;
+   const uint16_t *pix = skip_frame ? NULL : surf.pixels16;
    video_cb(pix, width, height, FB_WIDTH << 1);
 #endif
 
-   audio_batch_cb(sound_buf, spec.SoundBufSize);
+   if (spec.SoundBufSize)
+      audio_batch_cb(sound_buf, spec.SoundBufSize);
 
    bool updated = false;
    if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE, &updated) && updated)
       check_variables();
 
+   if (audio_sample_rate_changed)
+   {
+      set_audio_sample_rate();
+      update_geometry(width, height, true);
+   }
+   else if (resolution_changed)
+      update_geometry(width, height, false);
+
    if (resolution_changed)
-      update_geometry(width, height);
+   {
+      if (log_cb)
+         log_cb(RETRO_LOG_DEBUG, "[%s]: VIP memory usage: %u bytes.\n", mednafen_core_str, VIP_GetMemoryUsage());
+   }
 }
 
 void retro_get_system_info(struct retro_system_info *info)
@@ -2549,7 +3118,7 @@ void retro_get_system_av_info(struct retro_system_av_info *info)
 {
    memset(info, 0, sizeof(*info));
    info->timing.fps            = MEDNAFEN_CORE_TIMING_FPS;
-   info->timing.sample_rate    = 44100;
+   info->timing.sample_rate    = get_audio_sample_rate();
    info->geometry.base_width   = MEDNAFEN_CORE_GEOMETRY_BASE_W;
    info->geometry.base_height  = MEDNAFEN_CORE_GEOMETRY_BASE_H;
    info->geometry.max_width    = MEDNAFEN_CORE_GEOMETRY_MAX_W;
@@ -2625,55 +3194,89 @@ void retro_set_video_refresh(retro_video_refresh_t cb)
    video_cb = cb;
 }
 
-size_t retro_serialize_size(void)
+/* RETRO_SAVESTATE_CONTEXT_*, or -1 if the frontend doesn't say */
+static int savestate_context(void)
 {
-   StateMem st;
+   int context = RETRO_SAVESTATE_CONTEXT_NORMAL;
 
-   st.data           = NULL;
-   st.loc            = 0;
-   st.len            = 0;
-   st.malloced       = 0;
+   if (!environ_cb(RETRO_ENVIRONMENT_GET_SAVESTATE_CONTEXT, &context))
+      return -1;
 
-   if (!MDFNSS_SaveSM(&st, 0, 0, NULL, NULL, NULL))
+   return context;
+}
+
+/* States for run-ahead and netplay rollback are only ever loaded into a
+ * running session, so they can leave out the framebuffers while the game
+ * has the VIP redraw them every frame.  Otherwise a game may draw into or
+ * read back a framebuffer, and a load must restore it. */
+static int serialize_data_only(int context)
+{
+   if (context != RETRO_SAVESTATE_CONTEXT_RUNAHEAD_SAME_INSTANCE
+         && context != RETRO_SAVESTATE_CONTEXT_RUNAHEAD_SAME_BINARY
+         && context != RETRO_SAVESTATE_CONTEXT_ROLLBACK_NETPLAY)
       return 0;
 
-   free(st.data);
-   return st.len;
+   return VIP_RedrawsFB();
+}
+
+size_t retro_serialize_size(void)
+{
+   /* data_only states may keep the framebuffers from one save to the
+    * next, so every context gets the full size.  The layout only changes
+    * with the loaded game (GPRAM size). */
+   if (!serialize_size)
+      serialize_size = MDFNSS_SizeSM(0);
+
+   return serialize_size;
 }
 
 bool retro_serialize(void *data, size_t size)
 {
+   const int context = savestate_context();
    StateMem st;
-   bool ret          = false;
-   uint8_t *_dat     = (uint8_t*)malloc(size);
 
-   if (!_dat)
-      return false;
+   /* Only the NORMAL context may be compressed, but frontend rewind saves
+    * in it too and expects every state to be retro_serialize_size()
+    * bytes, so the rest of the buffer is zeroed.  A state that doesn't
+    * compress into the buffer is saved plain. */
+   if (state_compression && context == RETRO_SAVESTATE_CONTEXT_NORMAL)
+   {
+      uint32_t packed = MDFNSS_SaveCompressed(data, size);
+
+      if (packed)
+      {
+         memset((uint8_t*)data + packed, 0, size - packed);
+         return true;
+      }
+   }
 
-   /* Mednafen can realloc the buffer so we need to ensure this is safe. */
-   st.data           = _dat;
+   /* Serialize straight into the frontend's buffer; SaveSM fails if the
+    * state doesn't fit rather than growing it. */
+   st.data           = (uint8_t*)data;
    st.loc            = 0;
    st.len            = 0;
    st.malloced       = size;
+   st.fixed          = true;
 
-   ret = MDFNSS_SaveSM(&st, 0, 0, NULL, NULL, NULL);
-
-   memcpy(data, st.data, size);
-   free(st.data);
-
-   return ret;
+   return MDFNSS_SaveSM(&st, 0, serialize_data_only(context), NULL, NULL, NULL);
 }
 
 bool retro_unserialize(const void *data, size_t size)
 {
    StateMem st;
+   bool ret;
 
    st.data           = (uint8_t*)data;
    st.loc            = 0;
    st.len            = size;
    st.malloced       = 0;
+   st.fixed          = false;
 
-   return MDFNSS_LoadSM(&st, 0, 0);
+   /* Even a failed load may have replaced part of memory */
+   ret = MDFNSS_LoadSM(&st, 0, 0);
+   DirtyAll();
+
+   return ret;
 }
 
 void *retro_get_memory_data(unsigned type)
@@ -194,6 +194,17 @@ struct retro_core_option_definition option_defs_us[] = {
       },
       "disabled",
    },
+   {
+      "vb_input_late_latch",
+      "Late Input Latching",
+      "Poll the controller when the game starts reading it during the frame instead of before the frame is emulated. Reduces input latency by up to one frame at no extra cost.",
+      {
+         { "disabled", NULL },
+         { "enabled", NULL },
+         { NULL, NULL },
+      },
+      "disabled",
+   },
    {
       "vb_cpu_emulation",
       "CPU emulation  (Restart)",
@@ -205,6 +216,143 @@ struct retro_core_option_definition option_defs_us[] = {
       },
       "fast",
    },
+   {
+      "vb_frameskip",
+      "Frameskip",
+      "Skip frames to avoid audio buffer under-run (crackling). Improves performance at the expense of visual smoothness. 'Auto' skips frames when advised by the frontend. 'Manual' utilises the 'Frameskip Threshold (%)' setting.",
+      {
+         { "disabled", NULL },
+         { "auto",     "Auto" },
+         { "manual",   "Manual" },
+         { NULL, NULL },
+      },
+      "disabled",
+   },
+   {
+      "vb_frameskip_threshold",
+      "Frameskip Threshold (%)",
+      "When 'Frameskip' is set to 'Manual', specifies the audio buffer occupancy threshold (percentage) below which frames will be skipped. Higher values reduce the risk of crackling by causing frames to be dropped more frequently.",
+      {
+         { "15", NULL },
+         { "18", NULL },
+         { "21", NULL },
+         { "24", NULL },
+         { "27", NULL },
+         { "30", NULL },
+         { "33", NULL },
+         { "36", NULL },
+         { "39", NULL },
+         { "42", NULL },
+         { "45", NULL },
+         { "48", NULL },
+         { "51", NULL },
+         { "54", NULL },
+         { "57", NULL },
+         { "60", NULL },
+         { NULL, NULL },
+      },
+      "33",
+   },
+   {
+      "vb_sample_rate",
+      "Audio Sample Rate (Hz)",
+      "Output sample rate. Pick the rate the frontend's audio driver runs at to avoid resampling twice. 'Native' outputs the VSU's own rate of ~41667 Hz, without interpolating between samples.",
+      {
+         { "22050",  NULL },
+         { "32000",  NULL },
+         { "44100",  NULL },
+         { "48000",  NULL },
+         { "native", "Native" },
+         { NULL, NULL },
+      },
+      "44100",
+   },
+   {
+      "vb_rewind",
+      "In-Core Rewind",
+      "Keep a delta-compressed history of recent frames inside the core, up to the chosen number of seconds. Play it back with 'In-Core Rewind Playback'.",
+      {
+         { "disabled", NULL },
+         { "5",  "5 seconds" },
+         { "10", "10 seconds" },
+         { "30", "30 seconds" },
+         { "60", "60 seconds" },
+         { NULL, NULL },
+      },
+      "disabled",
+   },
+   {
+      "vb_rewind_playback",
+      "In-Core Rewind Playback",
+      "Changing this to 'Reverse' steps the game back one frame at a time through the in-core rewind history, silently, replaying each frame with the input it was recorded with. Playback carries on forward from the oldest frame once the history is used up, or as soon as this is set back to 'Forward'. A saved 'Reverse' has no effect when a game is loaded.",
+      {
+         { "forward", "Forward" },
+         { "reverse", "Reverse" },
+         { NULL, NULL },
+      },
+      "forward",
+   },
+   {
+      "vb_state_compression",
+      "Compress Save States",
+      "Store save states LZ4-compressed, in about a quarter of the usual size. The state is still handed to the frontend at full size, zero-padded, so only frontends that compress or trim states themselves save space. Libretro doesn't tell a save to a slot apart from the frontend's own rewind, so with frontend rewind on, every rewind frame is compressed too: leave this off then. Needs a frontend that reports why it is saving; run-ahead and netplay states are never compressed. Compressed states load whatever this is set to.",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled",
+   },
+   {
+      "vb_run_ahead",
+      "Run-Ahead (Native)",
+      "Cut input latency by emulating the chosen number of frames ahead and showing the last one, then returning to the real frame from an in-memory snapshot. Much cheaper than frontend run-ahead; do not enable both.",
+      {
+         { "disabled", NULL },
+         { "1", "1 frame" },
+         { "2", "2 frames" },
+         { "3", "3 frames" },
+         { "4", "4 frames" },
+         { NULL, NULL },
+      },
+      "disabled",
+   },
+   {
+      "vb_lightweight_fastforward",
+      "Lightweight Fast-Forward",
+      "While the frontend is fast-forwarding, only display one in every N frames and skip audio synthesis. Emulation itself is unaffected, so save states and timing stay exact.",
+      {
+         { "disabled", NULL },
+         { "2",        "1 in 2 frames" },
+         { "4",        "1 in 4 frames" },
+         { "8",        "1 in 8 frames" },
+         { NULL, NULL },
+      },
+      "disabled",
+   },
+   {
+      "vb_audio_slices",
+      "Sub-Frame Audio Delivery",
+      "Hand audio to the frontend in several pieces per frame, as the display reaches each eye or each display region, instead of once at the end. Lowers audio latency for streaming setups; the sound itself is unchanged.",
+      {
+         { "disabled",   NULL },
+         { "per_eye",    "Per Eye (2 per frame)" },
+         { "per_region", "Per Display Region (4 per frame)" },
+         { NULL, NULL },
+      },
+      "disabled",
+   },
+   {
+      "vb_dirty_tracking",
+      "Dirty Page Tracking",
+      "Record which 256-byte pages of WRAM, GPRAM, DRAM and CHR RAM each frame writes, and log how many per frame on average when the game is closed. For profiling save state and rewind costs; adds a little work to every memory write.",
+      {
+         { "disabled", NULL },
+         { "enabled",  NULL },
+         { NULL, NULL },
+      },
+      "disabled",
+   },
    { NULL, NULL, NULL, { NULL, NULL }, NULL },
 };
 
@@ -0,0 +1,264 @@
+/* Mednafen - Multi-system Emulator
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <string.h>
+
+#include <retro_inline.h>
+
+#include <lz4/lz4_block.h>
+
+/* A block is a run of sequences: a token (literal count << 4 | match
+ * length - 4, 15 meaning "more in following bytes"), the literals, a
+ * 16-bit little-endian match offset and the extra length bytes.  The
+ * last sequence is literals only; the format wants the final 5 bytes to
+ * be literals and no match to start within the final 12. */
+
+#define MIN_MATCH     4
+#define LAST_LITERALS 5
+#define MF_LIMIT      12
+#define MAX_OFFSET    65535
+#define HASH_LOG      14
+
+static uint32_t HashTable[1 << HASH_LOG];
+
+static INLINE uint32_t Read32(const uint8_t *p)
+{
+   uint32_t v;
+
+   memcpy(&v, p, 4);
+
+   return v;
+}
+
+static INLINE uint64_t Read64(const uint8_t *p)
+{
+   uint64_t v;
+
+   memcpy(&v, p, 8);
+
+   return v;
+}
+
+static INLINE uint32_t Hash(uint32_t v)
+{
+   return (v * 2654435761U) >> (32 - HASH_LOG);
+}
+
+static INLINE uint8_t *PutLength(uint8_t *op, uint32_t len)
+{
+   for(; len >= 255; len -= 255)
+      *op++ = 255;
+   *op++ = len;
+
+   return op;
+}
+
+/* Worst case for one sequence, so the writes below need no checks. */
+static INLINE uint32_t SequenceMax(uint32_t lit, uint32_t match)
+{
+   return 1 + lit / 255 + 1 + lit + 2 + match / 255 + 1;
+}
+
+uint32_t LZ4B_Compress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap)
+{
+   const uint8_t *ip     = src;
+   const uint8_t *anchor = src;
+   const uint8_t *end    = src + len;
+   uint8_t *op           = dst;
+   uint8_t *oend         = dst + cap;
+   uint32_t lit;
+
+   memset(HashTable, 0, sizeof(HashTable));
+
+   if(len > MF_LIMIT)
+   {
+      const uint8_t *mflimit    = end - MF_LIMIT;
+      const uint8_t *matchlimit = end - LAST_LITERALS;
+      uint32_t misses           = 0;
+
+      while(ip <= mflimit)
+      {
+         const uint32_t seq = Read32(ip);
+         const uint32_t h   = Hash(seq);
+         const uint8_t *ref = src + HashTable[h];
+         const uint8_t *mp;
+         uint32_t match;
+
+         HashTable[h] = ip - src;
+
+         if(ref >= ip || ip - ref > MAX_OFFSET || Read32(ref) != seq)
+         {
+            /* Step faster through data that doesn't compress */
+            ip += 1 + (misses++ >> 6);
+            continue;
+         }
+         misses = 0;
+
+         while(ip > anchor && ref > src && ip[-1] == ref[-1])
+         {
+            ip--;
+            ref--;
+         }
+
+         mp = ip + MIN_MATCH;
+         {
+            const uint8_t *rp = ref + MIN_MATCH;
+
+            while(mp + 8 <= matchlimit && Read64(mp) == Read64(rp))
+            {
+               mp += 8;
+               rp += 8;
+            }
+            while(mp < matchlimit && *mp == *rp)
+            {
+               mp++;
+               rp++;
+            }
+         }
+
+         lit   = ip - anchor;
+         match = mp - ip - MIN_MATCH;
+
+         if((uint32_t)(oend - op) < SequenceMax(lit, match))
+            return 0;
+
+         {
+            uint8_t *token = op++;
+
+            *token = ((lit < 15) ? lit : 15) << 4;
+            if(lit >= 15)
+               op = PutLength(op, lit - 15);
+            memcpy(op, anchor, lit);
+            op += lit;
+
+            *op++ = (ip - ref) & 0xFF;
+            *op++ = (ip - ref) >> 8;
+
+            *token |= (match < 15) ? match : 15;
+            if(match >= 15)
+               op = PutLength(op, match - 15);
+         }
+
+         ip     = mp;
+         anchor = ip;
+
+         if(ip <= mflimit)
+            HashTable[Hash(Read32(ip - 2))] = ip - 2 - src;
+      }
+   }
+
+   lit = end - anchor;
+
+   if((uint32_t)(oend - op) < SequenceMax(lit, 0))
+      return 0;
+
+   *op++ = ((lit < 15) ? lit : 15) << 4;
+   if(lit >= 15)
+      op = PutLength(op, lit - 15);
+   memcpy(op, anchor, lit);
+   op += lit;
+
+   return op - dst;
+}
+
+/* Returns false on running out of input. */
+static INLINE int GetLength(const uint8_t **ip, const uint8_t *iend, uint32_t *len)
+{
+   uint8_t b;
+
+   do
+   {
+      if(*ip >= iend)
+         return 0;
+      b     = *(*ip)++;
+      *len += b;
+   } while(b == 255);
+
+   return 1;
+}
+
+int32_t LZ4B_Decompress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap)
+{
+   const uint8_t *ip   = src;
+   const uint8_t *iend = src + len;
+   uint8_t *op         = dst;
+   uint8_t *oend       = dst + cap;
+
+   while(ip < iend)
+   {
+      const uint8_t token = *ip++;
+      uint32_t lit        = token >> 4;
+      uint32_t match      = token & 0xF;
+      uint32_t offset;
+
+      if(lit == 15 && !GetLength(&ip, iend, &lit))
+         return -1;
+
+      if(lit > (uint32_t)(iend - ip) || lit > (uint32_t)(oend - op))
+         return -1;
+
+      memcpy(op, ip, lit);
+      op += lit;
+      ip += lit;
+
+      /* The last sequence has no match */
+      if(ip == iend)
+         break;
+
+      if(iend - ip < 2)
+         return -1;
+
+      offset = ip[0] | (ip[1] << 8);
+      ip    += 2;
+
+      if(!offset || offset > (uint32_t)(op - dst))
+         return -1;
+
+      if(match == 15 && !GetLength(&ip, iend, &match))
+         return -1;
+      match += MIN_MATCH;
+
+      if(match > (uint32_t)(oend - op))
+         return -1;
+
+      if(offset >= match)
+      {
+         memcpy(op, op - offset, match);
+         op += match;
+      }
+      else
+      {
+         /* The match repeats the last 'offset' bytes; everything from
+          * 'ref' on is that pattern, so each copy can double in size. */
+         const uint8_t *ref = op - offset;
+
+         while(match)
+         {
+            uint32_t chunk = op - ref;
+
+            if(chunk > match)
+               chunk = match;
+
+            memcpy(op, ref, chunk);
+            op    += chunk;
+            match -= chunk;
+         }
+      }
+   }
+
+   return op - dst;
+}
@@ -43,6 +43,13 @@ typedef struct
 
 	// Number of frames currently in internal sound buffer.  Set by the system emulation code, to be read by the driver code.
 	int32 SoundBufSize;
+
+	// Skip rendering this frame if true.  Set by the driver code.  Emulated state (framebuffer swapping, interrupts,
+	// drawing status timing) advances exactly as for a rendered frame; only rasterisation and output conversion are skipped.
+	bool skip;
+
+	// Rasterise as normal but leave the surface untouched this frame.  Set by the driver code.
+	bool skip_convert;
 } EmulateSpecStruct;
 
 #ifdef __cplusplus
@@ -101,6 +101,49 @@ static INLINE blip_resampled_time_t Blip_Buffer_resampled_time(
 blip_resampled_time_t Blip_Buffer_clock_rate_factor(Blip_Buffer* bbuf,
       long clock_rate);
 
+// Stereo variant of Blip_Buffer, holding left and right interleaved so both
+// sides share one time base and are read out in a single pass straight into
+// an interleaved output buffer.
+typedef struct
+{
+   blip_u64 factor;
+   blip_resampled_time_t offset;
+   blip_buf_t_* buffer;          // L, R, L, R, ...
+   blip_long buffer_size;        // In sample frames
+   blip_long reader_accum[2];
+   int bass_shift;
+   long sample_rate;
+   long clock_rate;
+   int bass_freq;
+   int length;
+   int no_interp;                // Transitions land on whole samples
+   int divider;                  // Clocks per sample in native mode, else 0
+   blip_long clock_rem;          // Clocks since the last whole sample, native mode
+   int modified;                 // Buffer may hold non-zero deltas
+} Blip_StereoBuffer;
+
+void Blip_StereoBuffer_init(Blip_StereoBuffer* sbuf);
+void Blip_StereoBuffer_deinit(Blip_StereoBuffer* sbuf);
+blargg_err_t Blip_StereoBuffer_set_sample_rate(Blip_StereoBuffer* sbuf,
+      long samples_per_sec, int msec_length);
+void Blip_StereoBuffer_set_clock_rate(Blip_StereoBuffer* sbuf, long clock_rate);
+
+// Set the output rate to exactly 1/'divider' of 'clock_rate' and insert every
+// transition on a whole sample rather than interpolating it between two, for
+// sources whose output is natively sampled at that rate. The clocks left over
+// at each end_frame() are carried, so sample boundaries never drift; the
+// integer sample rate kept for sizing and the bass filter is truncated.
+blargg_err_t Blip_StereoBuffer_set_native_rate(Blip_StereoBuffer* sbuf,
+      long clock_rate, int divider, int msec_length);
+void Blip_StereoBuffer_bass_freq(Blip_StereoBuffer* sbuf, int frequency);
+void Blip_StereoBuffer_clear(Blip_StereoBuffer* sbuf);
+void Blip_StereoBuffer_end_frame(Blip_StereoBuffer* sbuf, blip_time_t time);
+
+// Read at most 'max_frames' sample frames into 'dest' as interleaved L/R pairs,
+// removing them from the buffer. Returns number of sample frames read.
+long Blip_StereoBuffer_read_samples(Blip_StereoBuffer* sbuf, blip_sample_t* dest,
+      long max_frames);
+
 
 #define BLIP_BUFFER_ACCURACY 32
 #define BLIP_PHASE_BITS 8
@@ -218,6 +261,72 @@ static INLINE void Blip_Synth_offset_resampled(
    buf [1] = right;
 }
 
+// Collects the left and right amplitude transitions that land on the same clock,
+// so they can be inserted into a Blip_StereoBuffer with one impulse per side.
+// The result is bit-identical to calling Blip_Synth_offset() for every delta on
+// a pair of mono buffers, as the shifted part of each delta is accumulated
+// separately.
+typedef struct
+{
+   blip_long delta[2];
+   blip_long delta_hi[2];
+   int pending;
+} Blip_StereoDelta;
+
+static INLINE void Blip_StereoDelta_clear(Blip_StereoDelta* sd)
+{
+   sd->delta[0] = sd->delta[1] = 0;
+   sd->delta_hi[0] = sd->delta_hi[1] = 0;
+   sd->pending = 0;
+}
+
+static INLINE void Blip_StereoDelta_add(const Blip_Synth* synth, Blip_StereoDelta* sd,
+                                 int left, int right)
+{
+   left  *= synth->delta_factor;
+   right *= synth->delta_factor;
+
+   sd->delta[0]    += left;
+   sd->delta_hi[0] += left >> BLIP_PHASE_BITS;
+   sd->delta[1]    += right;
+   sd->delta_hi[1] += right >> BLIP_PHASE_BITS;
+   sd->pending      = 1;
+}
+
+static INLINE void Blip_StereoDelta_flush(Blip_StereoDelta* sd, blip_time_t t,
+                                 Blip_StereoBuffer* sbuf)
+{
+   blip_resampled_time_t time;
+   blip_long *buf;
+   int phase;
+
+   if(!sd->pending)
+      return;
+
+   time  = t * sbuf->factor + sbuf->offset;
+   buf   = sbuf->buffer + (time >> BLIP_BUFFER_ACCURACY) * 2;
+
+   sbuf->modified = 1;
+
+   if(sbuf->no_interp)
+   {
+      buf [0] += sd->delta[0];
+      buf [1] += sd->delta[1];
+      Blip_StereoDelta_clear(sd);
+      return;
+   }
+
+   phase = (int)(time >> (BLIP_BUFFER_ACCURACY - BLIP_PHASE_BITS) &
+                     (blip_res - 1));
+
+   buf [0] += sd->delta[0] - sd->delta_hi[0] * phase;
+   buf [1] += sd->delta[1] - sd->delta_hi[1] * phase;
+   buf [2] += sd->delta_hi[0] * phase;
+   buf [3] += sd->delta_hi[1] * phase;
+
+   Blip_StereoDelta_clear(sd);
+}
+
 static INLINE long Blip_Buffer_samples_avail(Blip_Buffer* bbuf)
 {
    return (long)(bbuf->offset >> BLIP_BUFFER_ACCURACY);
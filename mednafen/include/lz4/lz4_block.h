@@ -0,0 +1,27 @@
+#ifndef LZ4_BLOCK_H
+#define LZ4_BLOCK_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* LZ4 block format (no frame header or checksums), so blocks can be
+ * checked against the reference implementation. */
+
+/* Largest compressed size of 'len' input bytes. */
+#define LZ4B_COMPRESS_BOUND(len) ((len) + (len) / 255 + 16)
+
+/* Returns the compressed size, or 0 if it doesn't fit in 'cap' bytes. */
+uint32_t LZ4B_Compress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap);
+
+/* Returns the decompressed size, or -1 if the block is malformed or
+ * would overrun 'cap' bytes. */
+int32_t LZ4B_Decompress(const uint8_t *src, uint32_t len, uint8_t *dst, uint32_t cap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,6 +7,11 @@
 #include <stdlib.h>
 #include <math.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLIP_STEREO_SSE2
+#endif
+
 #ifndef ULLONG_MAX
 #define ULLONG_MAX 18446744073709551615ULL
 #endif
@@ -196,3 +201,287 @@ void Blip_Buffer_mix_samples(Blip_Buffer* bbuf, blip_sample_t const* in, long co
    }
    *out -= prev;
 }
+
+void Blip_StereoBuffer_init(Blip_StereoBuffer* sbuf)
+{
+   sbuf->factor          = (blip_u64)ULLONG_MAX;
+   sbuf->offset          = 0;
+   sbuf->buffer          = 0;
+   sbuf->buffer_size     = 0;
+   sbuf->reader_accum[0] = 0;
+   sbuf->reader_accum[1] = 0;
+   sbuf->bass_shift      = 0;
+   sbuf->sample_rate     = 0;
+   sbuf->clock_rate      = 0;
+   sbuf->bass_freq       = 16;
+   sbuf->length          = 0;
+   sbuf->no_interp       = 0;
+   sbuf->divider         = 0;
+   sbuf->clock_rem       = 0;
+   sbuf->modified        = 0;
+}
+
+void Blip_StereoBuffer_deinit(Blip_StereoBuffer* sbuf)
+{
+   if (sbuf->buffer)
+      free(sbuf->buffer);
+   sbuf->buffer      = 0;
+   sbuf->buffer_size = 0;
+}
+
+void Blip_StereoBuffer_clear(Blip_StereoBuffer* sbuf)
+{
+   sbuf->offset          = 0;
+   sbuf->clock_rem       = 0;
+   sbuf->reader_accum[0] = 0;
+   sbuf->reader_accum[1] = 0;
+   sbuf->modified        = 0;
+   if (sbuf->buffer)
+      memset(sbuf->buffer, 0, (sbuf->buffer_size + blip_buffer_extra_) * 2 * sizeof(blip_buf_t_));
+}
+
+blargg_err_t Blip_StereoBuffer_set_sample_rate(Blip_StereoBuffer* sbuf, long new_rate,
+      int msec)
+{
+   // same sizing rules as Blip_Buffer_set_sample_rate()
+   blip_s64 new_size = (ULLONG_MAX >> BLIP_BUFFER_ACCURACY) - blip_buffer_extra_ -
+                       64;
+
+   if (new_size > ((1LL << 30) - 1))
+      new_size = (1LL << 30) - 1;
+
+   if (msec != 0)
+   {
+      blip_s64 s = ((blip_s64)new_rate * (msec + 1) + 999) / 1000;
+      if (s < new_size)
+         new_size = s;
+   }
+
+   if (sbuf->buffer_size != new_size)
+   {
+      void* p = realloc(sbuf->buffer, (new_size + blip_buffer_extra_) * 2 * sizeof(blip_buf_t_));
+      if (!p)
+         return "Out of memory";
+
+      sbuf->buffer = (blip_buf_t_*) p;
+   }
+
+   sbuf->buffer_size = new_size;
+
+   sbuf->sample_rate = new_rate;
+   sbuf->length = new_size * 1000 / new_rate - 1;
+   if (sbuf->clock_rate)
+      Blip_StereoBuffer_set_clock_rate(sbuf, sbuf->clock_rate);
+   Blip_StereoBuffer_bass_freq(sbuf, sbuf->bass_freq);
+
+   Blip_StereoBuffer_clear(sbuf);
+
+   return 0; // success
+}
+
+void Blip_StereoBuffer_set_clock_rate(Blip_StereoBuffer* sbuf, long rate)
+{
+   double ratio = (double) sbuf->sample_rate / rate;
+   sbuf->clock_rate = rate;
+   sbuf->factor = (blip_u64)(blip_s64) floor(ratio * (1LL << BLIP_BUFFER_ACCURACY) + 0.5);
+   sbuf->no_interp = 0;
+   sbuf->divider   = 0;
+}
+
+blargg_err_t Blip_StereoBuffer_set_native_rate(Blip_StereoBuffer* sbuf, long clock_rate,
+      int divider, int msec)
+{
+   blargg_err_t err;
+
+   sbuf->clock_rate = clock_rate;
+   err = Blip_StereoBuffer_set_sample_rate(sbuf, clock_rate / divider, msec);
+   if (err)
+      return err;
+
+   // 2^32 / divider rounded up, so a clock that is a whole multiple of the
+   // divider past a sample boundary never lands a sample early. end_frame()
+   // rebases offset on the exact boundary, so the excess cannot build up
+   // far enough to land one late either.
+   sbuf->factor    = (((blip_u64)1 << BLIP_BUFFER_ACCURACY) + divider - 1) / divider;
+   sbuf->no_interp = 1;
+   sbuf->divider   = divider;
+   sbuf->clock_rem = 0;
+
+   return 0;
+}
+
+void Blip_StereoBuffer_bass_freq(Blip_StereoBuffer* sbuf, int freq)
+{
+   int shift = 31;
+   sbuf->bass_freq = freq;
+   if (freq > 0)
+   {
+      long f;
+      shift = 13;
+      f     = (freq << 16) / sbuf->sample_rate;
+      while ((f >>= 1) && --shift) { }
+   }
+   sbuf->bass_shift = shift;
+}
+
+void Blip_StereoBuffer_end_frame(Blip_StereoBuffer* sbuf, blip_time_t t)
+{
+   if (sbuf->divider)
+   {
+      blip_long total = sbuf->clock_rem + t;
+
+      sbuf->clock_rem = total % sbuf->divider;
+      sbuf->offset    = (((sbuf->offset >> BLIP_BUFFER_ACCURACY) + total / sbuf->divider)
+                         << BLIP_BUFFER_ACCURACY) + (blip_u64)sbuf->clock_rem * sbuf->factor;
+      return;
+   }
+
+   sbuf->offset += t * sbuf->factor;
+}
+
+static void Blip_StereoBuffer_remove_samples(Blip_StereoBuffer* sbuf, long count)
+{
+   long remain, i;
+
+   sbuf->offset -= (blip_resampled_time_t) count << BLIP_BUFFER_ACCURACY;
+
+   // an untouched buffer is all zeroes, nothing to move
+   if (!sbuf->modified)
+      return;
+
+   // copy remaining samples to beginning and clear old samples
+   remain = (long)(sbuf->offset >> BLIP_BUFFER_ACCURACY) + blip_buffer_extra_;
+   memmove(sbuf->buffer, sbuf->buffer + count * 2, remain * 2 * sizeof(blip_buf_t_));
+   memset(sbuf->buffer + remain * 2, 0, count * 2 * sizeof(blip_buf_t_));
+
+   for (i = 0; i < remain * 2; i++)
+      if (sbuf->buffer[i])
+         return;
+
+   sbuf->modified = 0;
+}
+
+// With no deltas in the buffer the integrators only decay; once an integrator
+// is non-negative with (accum >> bass) == 0 its input term is zero and it stays
+// put for good.
+static INLINE int Blip_StereoBuffer_settled(blip_long accum, int bass)
+{
+   return accum >= 0 && !(accum >> bass);
+}
+
+// Read-out of an untouched buffer: the decaying bass-filter tail, then a
+// constant level (silence, unless the bass filter is disabled).
+static void Blip_StereoBuffer_read_silence(Blip_StereoBuffer* sbuf, blip_sample_t* out,
+                              long count)
+{
+   int const bass    = sbuf->bass_shift;
+   blip_long accum_l = sbuf->reader_accum[0];
+   blip_long accum_r = sbuf->reader_accum[1];
+   blip_long l, r;
+
+   for (;;)
+   {
+      l = accum_l >> (blip_sample_bits - 16);
+      r = accum_r >> (blip_sample_bits - 16);
+      if ((blip_sample_t) l != l)
+         l = 0x7FFF - (l >> 24);
+      if ((blip_sample_t) r != r)
+         r = 0x7FFF - (r >> 24);
+
+      if (!count || (Blip_StereoBuffer_settled(accum_l, bass) &&
+                     Blip_StereoBuffer_settled(accum_r, bass)))
+         break;
+
+      out[0] = (blip_sample_t) l;
+      out[1] = (blip_sample_t) r;
+      out += 2;
+
+      accum_l -= accum_l >> bass;
+      accum_r -= accum_r >> bass;
+      count--;
+   }
+
+   sbuf->reader_accum[0] = accum_l;
+   sbuf->reader_accum[1] = accum_r;
+
+   if (count && !l && !r)
+      memset(out, 0, count * 2 * sizeof(*out));
+   else
+   {
+      for (; count; --count, out += 2)
+      {
+         out[0] = (blip_sample_t) l;
+         out[1] = (blip_sample_t) r;
+      }
+   }
+}
+
+long Blip_StereoBuffer_read_samples(Blip_StereoBuffer* sbuf, blip_sample_t* out,
+                              long max_frames)
+{
+   long count = (long)(sbuf->offset >> BLIP_BUFFER_ACCURACY);
+   if (count > max_frames)
+      count = max_frames;
+
+   if (count && !sbuf->modified)
+   {
+      Blip_StereoBuffer_read_silence(sbuf, out, count);
+      Blip_StereoBuffer_remove_samples(sbuf, count);
+   }
+   else if (count)
+   {
+      const blip_buf_t_* in = sbuf->buffer;
+      int const bass        = sbuf->bass_shift;
+      blip_long n;
+
+#ifdef BLIP_STEREO_SSE2
+      // Both integrators run side by side in the low two lanes; the
+      // saturating pack matches the scalar clamp below.
+      const __m128i bass_count   = _mm_cvtsi32_si128(bass);
+      const __m128i sample_count = _mm_cvtsi32_si128(blip_sample_bits - 16);
+      __m128i accum = _mm_set_epi32(0, 0, sbuf->reader_accum[1], sbuf->reader_accum[0]);
+
+      for (n = count; n; --n)
+      {
+         __m128i s      = _mm_sra_epi32(accum, sample_count);
+         int32_t packed = _mm_cvtsi128_si32(_mm_packs_epi32(s, s));
+
+         memcpy(out, &packed, sizeof(packed));
+         out += 2;
+
+         accum = _mm_add_epi32(accum, _mm_sub_epi32(
+                  _mm_loadl_epi64((const __m128i*)in), _mm_sra_epi32(accum, bass_count)));
+         in += 2;
+      }
+
+      sbuf->reader_accum[0] = _mm_cvtsi128_si32(accum);
+      sbuf->reader_accum[1] = _mm_cvtsi128_si32(_mm_srli_si128(accum, 4));
+#else
+      blip_long accum_l = sbuf->reader_accum[0];
+      blip_long accum_r = sbuf->reader_accum[1];
+
+      for (n = count; n; --n)
+      {
+         blip_long l = accum_l >> (blip_sample_bits - 16);
+         blip_long r = accum_r >> (blip_sample_bits - 16);
+         if ((blip_sample_t) l != l)
+            l = 0x7FFF - (l >> 24);
+         if ((blip_sample_t) r != r)
+            r = 0x7FFF - (r >> 24);
+         out[0] = (blip_sample_t) l;
+         out[1] = (blip_sample_t) r;
+         out += 2;
+
+         accum_l += in[0] - (accum_l >> bass);
+         accum_r += in[1] - (accum_r >> bass);
+         in += 2;
+      }
+
+      sbuf->reader_accum[0] = accum_l;
+      sbuf->reader_accum[1] = accum_r;
+#endif
+
+      Blip_StereoBuffer_remove_samples(sbuf, count);
+   }
+   return count;
+}
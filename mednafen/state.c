@@ -25,6 +25,8 @@
 #include <compat/strl.h>
 #include <retro_inline.h>
 
+#include <lz4/lz4_block.h>
+
 #include "state.h"
 
 #define SSEEK_END	2
@@ -36,6 +38,54 @@
 /* Forward declaration */
 extern int StateAction(StateMem *sm, int load, int data_only);
 
+/* Layout fingerprint: a hash of every section name, field name, size and
+ * flag word in save order.  Saves store it in header bytes 8-15; a load
+ * whose fingerprint matches the current layout reads fields by position
+ * instead of looking each one up by name.  Full and data_only states
+ * have different layouts, so one is kept for each. */
+static uint64_t SaveLayout;
+static uint64_t KnownLayout[2];
+static bool KnownLayoutValid[2];
+static bool FastLoad;
+
+/* Raw snapshots (MDFNSS_SaveRaw/LoadRaw) hold only the variables' bytes in
+ * native layout, for in-process use.  The header records the core version
+ * and sizeof(bool) in bytes 8-15 next to the layout fingerprint; a snapshot
+ * is only loaded if all three match. */
+static bool RawMode;
+
+#define RAW_MAGIC "MDFNRAW1"
+#define RAW_HEADER_SIZE 32
+
+/* Compressed container: "MDFNSVLZ", the state's size and the block's size
+ * (32-bit LSB), then one LZ4 block holding a complete MDFNSVST state. */
+#define PACK_MAGIC "MDFNSVLZ"
+#define PACK_HEADER_SIZE 16
+
+static uint8_t *PackBuf;
+static uint32_t PackBufSize;
+
+/* State hashing (MDFNSS_HashState): every field goes through XXH64 in its
+ * saved byte order, seeded with the hash so far, one chain per section. */
+static bool HashMode;
+static MDFNSS_SectionHash *HashOut;
+static unsigned HashMax;
+static unsigned HashCount;
+static uint64_t HashTotal;
+
+static INLINE uint64_t LayoutHash(uint64_t h, const void *data, size_t len)
+{
+   const uint8_t *p = (const uint8_t *)data;
+
+   while(len--)
+   {
+      h ^= *p++;
+      h *= 1099511628211ULL;
+   }
+
+   return h;
+}
+
 static INLINE void MDFN_en32lsb(uint8_t *buf, uint32_t morp)
 {
    buf[0]=morp;
@@ -140,7 +190,17 @@ static int32_t smem_write(StateMem *st, void *buffer, uint32_t len)
 {
    if ((len + st->loc) > st->malloced)
    {
-      uint32_t newsize = (st->malloced >= 32768) ? st->malloced : 32768;
+      uint32_t newsize;
+
+      if (st->fixed)
+      {
+         st->loc += len;
+         if (st->loc > st->len)
+            st->len = st->loc;
+         return 0;
+      }
+
+      newsize = (st->malloced >= 32768) ? st->malloced : 32768;
 
       while(newsize < (len + st->loc))
          newsize *= 2;
@@ -196,6 +256,254 @@ static int smem_read32le(StateMem *st, uint32_t *b)
    return 4;
 }
 
+static void HashSection(const char *sname)
+{
+   uint8_t sname_tmp[32];
+   size_t sname_len = strlen(sname);
+
+   memset(sname_tmp, 0, sizeof(sname_tmp));
+   memcpy((char *)sname_tmp, sname, (sname_len < 32) ? sname_len : 32);
+
+   SaveLayout = LayoutHash(SaveLayout, sname_tmp, 32);
+}
+
+static void HashField(const SFORMAT *sf)
+{
+   size_t name_len = strlen(sf->name);
+   uint8_t len8;
+
+   if(name_len > 255)
+      name_len = 255;
+   len8 = name_len;
+
+   SaveLayout = LayoutHash(SaveLayout, &len8, 1);
+   SaveLayout = LayoutHash(SaveLayout, sf->name, name_len);
+   SaveLayout = LayoutHash(SaveLayout, &sf->size, sizeof(sf->size));
+   SaveLayout = LayoutHash(SaveLayout, &sf->flags, sizeof(sf->flags));
+}
+
+static INLINE uint32_t RawFieldSize(const SFORMAT *sf)
+{
+   return (sf->flags & MDFNSTATE_BOOL) ? sf->size * sizeof(bool) : sf->size;
+}
+
+static void RawWrite(StateMem *st, SFORMAT *sf)
+{
+   for(; sf->size || sf->name; sf++)
+   {
+      if(!sf->size || !sf->v)
+         continue;
+
+      if(sf->size == (uint32_t)~0)
+      {
+         RawWrite(st, (SFORMAT *)sf->v);
+         continue;
+      }
+
+      HashField(sf);
+      smem_write(st, sf->v, RawFieldSize(sf));
+   }
+}
+
+static int RawRead(StateMem *st, SFORMAT *sf)
+{
+   for(; sf->size || sf->name; sf++)
+   {
+      uint32_t len;
+
+      if(!sf->size || !sf->v)
+         continue;
+
+      if(sf->size == (uint32_t)~0)
+      {
+         if(!RawRead(st, (SFORMAT *)sf->v))
+            return 0;
+         continue;
+      }
+
+      len = RawFieldSize(sf);
+      if(smem_read(st, sf->v, len) != (int32_t)len)
+         return 0;
+   }
+
+   return 1;
+}
+
+#ifdef MSB_FIRST
+/* Converts a field between native and saved (little-endian) byte order;
+ * it is its own inverse. */
+static void SwapField(SFORMAT *sf)
+{
+   if(sf->flags & MDFNSTATE_BOOL)
+   {
+
+   }
+   else if(sf->flags & MDFNSTATE_RLSB64)
+      Endian_A64_Swap(sf->v, sf->size / sizeof(uint64_t));
+   else if(sf->flags & MDFNSTATE_RLSB32)
+      Endian_A32_Swap(sf->v, sf->size / sizeof(uint32_t));
+   else if(sf->flags & MDFNSTATE_RLSB16)
+      Endian_A16_Swap(sf->v, sf->size / sizeof(uint16_t));
+   else if(sf->flags & RLSB)
+      FlipByteOrder((uint8_t*)sf->v, sf->size);
+}
+#endif
+
+#define XXH_P1 0x9E3779B185EBCA87ULL
+#define XXH_P2 0xC2B2AE3D27D4EB4FULL
+#define XXH_P3 0x165667B19E3779F9ULL
+#define XXH_P4 0x85EBCA77C2B2AE63ULL
+#define XXH_P5 0x27D4EB2F165667C5ULL
+
+static INLINE uint64_t Rotl64(uint64_t v, unsigned r)
+{
+   return (v << r) | (v >> (64 - r));
+}
+
+static INLINE uint64_t ReadLE64(const uint8_t *p)
+{
+   uint64_t v;
+
+   memcpy(&v, p, 8);
+#ifdef MSB_FIRST
+   Endian_A64_Swap(&v, 1);
+#endif
+
+   return v;
+}
+
+static INLINE uint32_t ReadLE32(const uint8_t *p)
+{
+   uint32_t v;
+
+   memcpy(&v, p, 4);
+#ifdef MSB_FIRST
+   Endian_A32_Swap(&v, 1);
+#endif
+
+   return v;
+}
+
+static INLINE uint64_t XXH64_Round(uint64_t acc, uint64_t in)
+{
+   acc += in * XXH_P2;
+   acc  = Rotl64(acc, 31);
+
+   return acc * XXH_P1;
+}
+
+static INLINE uint64_t XXH64_Merge(uint64_t h, uint64_t v)
+{
+   h ^= XXH64_Round(0, v);
+
+   return h * XXH_P1 + XXH_P4;
+}
+
+static uint64_t XXH64(const uint8_t *p, uint32_t len, uint64_t seed)
+{
+   const uint8_t *end = p + len;
+   uint64_t h;
+
+   if(len >= 32)
+   {
+      uint64_t v1 = seed + XXH_P1 + XXH_P2;
+      uint64_t v2 = seed + XXH_P2;
+      uint64_t v3 = seed;
+      uint64_t v4 = seed - XXH_P1;
+
+      do
+      {
+         v1 = XXH64_Round(v1, ReadLE64(p));
+         v2 = XXH64_Round(v2, ReadLE64(p + 8));
+         v3 = XXH64_Round(v3, ReadLE64(p + 16));
+         v4 = XXH64_Round(v4, ReadLE64(p + 24));
+         p += 32;
+      } while(p + 32 <= end);
+
+      h = Rotl64(v1, 1) + Rotl64(v2, 7) + Rotl64(v3, 12) + Rotl64(v4, 18);
+      h = XXH64_Merge(h, v1);
+      h = XXH64_Merge(h, v2);
+      h = XXH64_Merge(h, v3);
+      h = XXH64_Merge(h, v4);
+   }
+   else
+      h = seed + XXH_P5;
+
+   h += len;
+
+   for(; p + 8 <= end; p += 8)
+   {
+      h ^= XXH64_Round(0, ReadLE64(p));
+      h  = Rotl64(h, 27) * XXH_P1 + XXH_P4;
+   }
+
+   if(p + 4 <= end)
+   {
+      h ^= (uint64_t)ReadLE32(p) * XXH_P1;
+      h  = Rotl64(h, 23) * XXH_P2 + XXH_P3;
+      p += 4;
+   }
+
+   for(; p < end; p++)
+   {
+      h ^= *p * XXH_P5;
+      h  = Rotl64(h, 11) * XXH_P1;
+   }
+
+   h ^= h >> 33;
+   h *= XXH_P2;
+   h ^= h >> 29;
+   h *= XXH_P3;
+   h ^= h >> 32;
+
+   return h;
+}
+
+static uint64_t HashFields(uint64_t h, SFORMAT *sf)
+{
+   for(; sf->size || sf->name; sf++)
+   {
+      if(!sf->size || !sf->v)
+         continue;
+
+      if(sf->size == (uint32_t)~0)
+      {
+         h = HashFields(h, (SFORMAT *)sf->v);
+         continue;
+      }
+
+      /* Bools as the 1-byte elements they're saved as */
+      if(sf->flags & MDFNSTATE_BOOL)
+      {
+         uint8_t tmp[256];
+         uint32_t i, j, n;
+
+         for(i = 0; i < sf->size; i += n)
+         {
+            n = sf->size - i;
+            if(n > sizeof(tmp))
+               n = sizeof(tmp);
+
+            for(j = 0; j < n; j++)
+               tmp[j] = ((bool *)sf->v)[i + j];
+
+            h = XXH64(tmp, n, h);
+         }
+         continue;
+      }
+
+#ifdef MSB_FIRST
+      SwapField(sf);
+#endif
+      h = XXH64((const uint8_t *)sf->v, sf->size, h);
+#ifdef MSB_FIRST
+      SwapField(sf);
+#endif
+   }
+
+   return h;
+}
+
 static bool SubWrite(StateMem *st, SFORMAT *sf)
 {
    while(sf->size || sf->name)	// Size can sometimes be zero, so also check for the text name.  These two should both be zero only at the end of a struct.
@@ -224,20 +532,11 @@ static bool SubWrite(StateMem *st, SFORMAT *sf)
       smem_write(st, nameo, 1 + nameo[0]);
       smem_write32le(st, bytesize);
 
+      HashField(sf);
+
 #ifdef MSB_FIRST
       /* Flip the byte order... */
-      if(sf->flags & MDFNSTATE_BOOL)
-      {
-
-      }
-      else if(sf->flags & MDFNSTATE_RLSB64)
-         Endian_A64_Swap(sf->v, bytesize / sizeof(uint64_t));
-      else if(sf->flags & MDFNSTATE_RLSB32)
-         Endian_A32_Swap(sf->v, bytesize / sizeof(uint32_t));
-      else if(sf->flags & MDFNSTATE_RLSB16)
-         Endian_A16_Swap(sf->v, bytesize / sizeof(uint16_t));
-      else if(sf->flags & RLSB)
-         FlipByteOrder((uint8_t*)sf->v, bytesize);
+      SwapField(sf);
 #endif
 
       // Special case for the evil bool type, to convert bool to 1-byte elements.
@@ -256,18 +555,7 @@ static bool SubWrite(StateMem *st, SFORMAT *sf)
 
 #ifdef MSB_FIRST
       /* Now restore the original byte order. */
-      if(sf->flags & MDFNSTATE_BOOL)
-      {
-
-      }
-      else if(sf->flags & MDFNSTATE_RLSB64)
-         Endian_A64_Swap(sf->v, bytesize / sizeof(uint64_t));
-      else if(sf->flags & MDFNSTATE_RLSB32)
-         Endian_A32_Swap(sf->v, bytesize / sizeof(uint32_t));
-      else if(sf->flags & MDFNSTATE_RLSB16)
-         Endian_A16_Swap(sf->v, bytesize / sizeof(uint16_t));
-      else if(sf->flags & RLSB)
-         FlipByteOrder((uint8_t*)sf->v, bytesize);
+      SwapField(sf);
 #endif
       sf++; 
    }
@@ -290,6 +578,8 @@ static int WriteStateChunk(StateMem *st, const char *sname, SFORMAT *sf)
 
    smem_write32le(st, 0);                // We'll come back and write this later.
 
+   HashSection(sname);
+
    data_start_pos = st->loc;
 
    if(!SubWrite(st, sf))
@@ -335,6 +625,31 @@ static SFORMAT *FindSF(const char *name, SFORMAT *sf)
    return NULL;
 }
 
+static void ReadField(StateMem *st, SFORMAT *sf)
+{
+   smem_read(st, (uint8_t *)sf->v, sf->size);
+
+   if(sf->flags & MDFNSTATE_BOOL)
+   {
+      int32_t bool_monster;
+      /* Converting downwards is necessary 
+       * for the case of sizeof(bool) > 1 */
+      for(bool_monster = sf->size - 1; bool_monster >= 0; bool_monster--)
+         ((bool *)sf->v)[bool_monster] = ((uint8_t *)sf->v)[bool_monster];
+   }
+
+#ifdef MSB_FIRST
+   if(sf->flags & MDFNSTATE_RLSB64)
+      Endian_A64_Swap(sf->v, sf->size / sizeof(uint64_t));
+   else if(sf->flags & MDFNSTATE_RLSB32)
+      Endian_A32_Swap(sf->v, sf->size / sizeof(uint32_t));
+   else if(sf->flags & MDFNSTATE_RLSB16)
+      Endian_A16_Swap(sf->v, sf->size / sizeof(uint16_t));
+   else if(sf->flags & RLSB)
+      FlipByteOrder((uint8_t*)sf->v, sf->size);
+#endif
+}
+
 static int ReadStateChunk(StateMem *st, SFORMAT *sf, int size)
 {
    int temp = st->loc;
@@ -360,45 +675,50 @@ static int ReadStateChunk(StateMem *st, SFORMAT *sf, int size)
 
       tmp = FindSF((char*)toa + 1, sf);
 
-      if(tmp)
+      if(tmp && recorded_size == tmp->size)
+         ReadField(st, tmp);
+      else
       {
-         uint32_t expected_size = tmp->size;	/* In bytes */
+         if(smem_seek(st, recorded_size, SSEEK_CUR) < 0)
+            return 0;
+      }
+   }
 
-         if(recorded_size != expected_size)
-         {
-            if(smem_seek(st, recorded_size, SSEEK_CUR) < 0)
-               return 0;
-         }
-         else
-         {
-            smem_read(st, (uint8_t *)tmp->v, expected_size);
+   return 1;
+}
 
-            if(tmp->flags & MDFNSTATE_BOOL)
-            {
-               int32_t bool_monster;
-               /* Converting downwards is necessary 
-                * for the case of sizeof(bool) > 1 */
-               for(bool_monster = expected_size - 1; bool_monster >= 0; bool_monster--)
-                  ((bool *)tmp->v)[bool_monster] = ((uint8_t *)tmp->v)[bool_monster];
-            }
+/* Fields are in exactly the order SubWrite() emits them, so only the
+ * name record has to be skipped. */
+static int ReadStateChunkFast(StateMem *st, SFORMAT *sf)
+{
+   while(sf->size || sf->name)
+   {
+      uint8_t name_len;
+      uint32_t recorded_size = 0;
 
-#ifdef MSB_FIRST
-            if(tmp->flags & MDFNSTATE_RLSB64)
-               Endian_A64_Swap(tmp->v, expected_size / sizeof(uint64_t));
-            else if(tmp->flags & MDFNSTATE_RLSB32)
-               Endian_A32_Swap(tmp->v, expected_size / sizeof(uint32_t));
-            else if(tmp->flags & MDFNSTATE_RLSB16)
-               Endian_A16_Swap(tmp->v, expected_size / sizeof(uint16_t));
-            else if(tmp->flags & RLSB)
-               FlipByteOrder((uint8_t*)tmp->v, expected_size);
-#endif
-         }
+      if(!sf->size || !sf->v)
+      {
+         sf++;
+         continue;
       }
-      else
+
+      if(sf->size == (uint32_t)~0)
       {
-         if(smem_seek(st, recorded_size, SSEEK_CUR) < 0)
+         if(!ReadStateChunkFast(st, (SFORMAT *)sf->v))
             return 0;
+
+         sf++;
+         continue;
       }
+
+      if(smem_read(st, &name_len, 1) != 1 || smem_seek(st, name_len, SSEEK_CUR) < 0)
+         return 0;
+
+      if(smem_read32le(st, &recorded_size) != 4 || recorded_size != sf->size)
+         return 0;
+
+      ReadField(st, sf);
+      sf++;
    }
 
    return 1;
@@ -408,6 +728,31 @@ static int MDFNSS_StateAction_internal(StateMem *st,
       int load, int data_only,
       struct SSDescriptor *section)
 {
+   if(HashMode)
+   {
+      uint64_t h = HashFields(0, section->sf);
+
+      if(HashCount < HashMax)
+      {
+         strlcpy(HashOut[HashCount].name, section->name, sizeof(HashOut[HashCount].name));
+         HashOut[HashCount].hash = h;
+      }
+      HashCount++;
+
+      HashTotal = XXH64_Merge(HashTotal, h);
+      return 1;
+   }
+
+   if(RawMode)
+   {
+      if(load)
+         return RawRead(st, section->sf);
+
+      HashSection(section->name);
+      RawWrite(st, section->sf);
+      return 1;
+   }
+
    if(load)
    {
       char sname[32];
@@ -416,6 +761,26 @@ static int MDFNSS_StateAction_internal(StateMem *st,
       int found         = 0;
       uint32_t total    = 0;
 
+      /* Sections are requested in save order, so with a matching layout
+       * the next one starts right where the previous one ended. */
+      if(FastLoad)
+      {
+         uint32_t start = st->loc;
+
+         if(smem_read(st, (uint8_t *)sname, 32) == 32
+               && smem_read32le(st, &tmp_size) == 4
+               && !strncmp(sname, section->name, 32))
+         {
+            if(!ReadStateChunkFast(st, section->sf) || st->loc != start + 32 + 4 + tmp_size)
+               return 0;
+            return 1;
+         }
+
+         /* Shouldn't happen with a matching fingerprint; scan by name. */
+         FastLoad = false;
+         smem_seek(st, 32, SSEEK_SET);
+      }
+
       while(smem_read(st, (uint8_t *)sname, 32) == 32)
       {
          if(smem_read32le(st, &tmp_size) != 4)
@@ -465,11 +830,10 @@ int MDFNSS_StateAction(void *st_p, int load, int data_only, SFORMAT *sf, const c
    return MDFNSS_StateAction_internal(st, load, 0, &love);
 }
 
-int MDFNSS_SaveSM(void *st_p, int a, int b, const void*c, const void*d, const void*e)
+static int SaveSM_internal(StateMem *st, int data_only)
 {
    uint32_t sizy;
    uint8_t header[32];
-   StateMem *st = (StateMem*)st_p;
    static const char *header_magic = "MDFNSVST";
    int neowidth = 0, neoheight = 0;
 
@@ -481,22 +845,163 @@ int MDFNSS_SaveSM(void *st_p, int a, int b, const void*c, const void*d, const vo
    MDFN_en32lsb(header + 28, neoheight);
    smem_write(st, header, 32);
 
-   if(!StateAction(st, 0, 0))
+   SaveLayout = 14695981039346656037ULL;
+
+   if(!StateAction(st, 0, data_only))
       return 0;
 
    sizy = st->loc;
    smem_seek(st, 16 + 4, SSEEK_SET);
    smem_write32le(st, sizy);
 
+   smem_seek(st, 8, SSEEK_SET);
+   smem_write32le(st, (uint32_t)SaveLayout);
+   smem_write32le(st, (uint32_t)(SaveLayout >> 32));
+   smem_seek(st, sizy, SSEEK_SET);
+
+   KnownLayout[data_only]      = SaveLayout;
+   KnownLayoutValid[data_only] = true;
+
    return 1;
 }
 
-int MDFNSS_LoadSM(void *st_p, int a, int b)
+int MDFNSS_SaveSM(void *st_p, int wantpreview, int data_only, const void*c, const void*d, const void*e)
+{
+   StateMem *st = (StateMem*)st_p;
+
+   data_only = (data_only != 0);
+
+   if(!SaveSM_internal(st, data_only))
+      return 0;
+
+   if (st->fixed && st->len > st->malloced)
+      return 0;
+
+   return 1;
+}
+
+uint32_t MDFNSS_SizeSM(int data_only)
+{
+   StateMem st;
+
+   /* A save into a zero-byte fixed buffer only walks the SFORMAT tables
+    * and adds up header, name and data lengths. */
+   st.data     = NULL;
+   st.loc      = 0;
+   st.len      = 0;
+   st.malloced = 0;
+   st.fixed    = true;
+
+   if(!SaveSM_internal(&st, data_only != 0))
+      return 0;
+
+   return st.len;
+}
+
+/* Which flavour of state has this fingerprint: 0 (full), 1 (data_only),
+ * or -1 if neither matches the current layout. */
+static int MatchLayout(uint64_t layout)
+{
+   int data_only;
+
+   for(data_only = 0; data_only < 2; data_only++)
+   {
+      if(!KnownLayoutValid[data_only])
+         MDFNSS_SizeSM(data_only);
+
+      if(KnownLayoutValid[data_only] && layout == KnownLayout[data_only])
+         return data_only;
+   }
+
+   return -1;
+}
+
+static uint8_t *GetPackBuf(uint32_t size)
+{
+   if(size > PackBufSize)
+   {
+      uint8_t *buf = (uint8_t *)realloc(PackBuf, size);
+
+      if(!buf)
+         return NULL;
+
+      PackBuf     = buf;
+      PackBufSize = size;
+   }
+
+   return PackBuf;
+}
+
+uint32_t MDFNSS_SaveCompressed(void *buf, uint32_t size)
+{
+   uint8_t *out      = (uint8_t *)buf;
+   uint32_t raw_size = MDFNSS_SizeSM(0);
+   uint32_t packed;
+   StateMem st;
+
+   if(!raw_size || size < PACK_HEADER_SIZE || !GetPackBuf(raw_size))
+      return 0;
+
+   st.data     = PackBuf;
+   st.loc      = 0;
+   st.len      = 0;
+   st.malloced = raw_size;
+   st.fixed    = true;
+
+   if(!MDFNSS_SaveSM(&st, 0, 0, NULL, NULL, NULL))
+      return 0;
+
+   if(!(packed = LZ4B_Compress(PackBuf, st.len, out + PACK_HEADER_SIZE, size - PACK_HEADER_SIZE)))
+      return 0;
+
+   memcpy(out, PACK_MAGIC, 8);
+   MDFN_en32lsb(out + 8, st.len);
+   MDFN_en32lsb(out + 12, packed);
+
+   return PACK_HEADER_SIZE + packed;
+}
+
+static int LoadCompressed(StateMem *st)
+{
+   const uint8_t *header = st->data + st->loc;
+   uint32_t raw_size     = MDFN_de32lsb(header + 8);
+   uint32_t packed       = MDFN_de32lsb(header + 12);
+   StateMem raw;
+
+   /* An LZ4 block expands at most about 255 times */
+   if(packed > st->len - st->loc - PACK_HEADER_SIZE || raw_size / 255 > packed)
+      return 0;
+
+   /* Only a plain state may be inside; PackBuf can't be reused for
+    * a nested container. */
+   if(!GetPackBuf(raw_size)
+         || LZ4B_Decompress(header + PACK_HEADER_SIZE, packed, PackBuf, raw_size) != (int32_t)raw_size
+         || raw_size < 8 || memcmp(PackBuf, "MDFNSVST", 8))
+      return 0;
+
+   st->loc += PACK_HEADER_SIZE + packed;
+
+   raw.data     = PackBuf;
+   raw.loc      = 0;
+   raw.len      = raw_size;
+   raw.malloced = 0;
+   raw.fixed    = false;
+
+   return MDFNSS_LoadSM(&raw, 0, 0);
+}
+
+int MDFNSS_LoadSM(void *st_p, int haspreview, int data_only)
 {
    uint8_t header[32];
    uint32_t stateversion;
+   uint64_t layout;
+   int match = -1;
+   int ret;
    StateMem *st = (StateMem*)st_p;
 
+   if(st->len - st->loc >= PACK_HEADER_SIZE && !memcmp(st->data + st->loc, PACK_MAGIC, 8))
+      return LoadCompressed(st);
+
    smem_read(st, header, 32);
 
    if(memcmp(header, "MEDNAFENSVESTATE", 16) && memcmp(header, "MDFNSVST", 8))
@@ -504,5 +1009,154 @@ int MDFNSS_LoadSM(void *st_p, int a, int b)
 
    stateversion = MDFN_de32lsb(header + 16);
 
-   return StateAction(st, stateversion, 0);
+   FastLoad = false;
+   if(!memcmp(header, "MDFNSVST", 8))
+   {
+      layout = MDFN_de32lsb(header + 8) | ((uint64_t)MDFN_de32lsb(header + 12) << 32);
+
+      if(layout)
+         match = MatchLayout(layout);
+   }
+
+   /* The state's own layout says whether it is data_only.  Otherwise
+    * load with the full tables; whatever the state lacks is left alone. */
+   FastLoad  = (match >= 0);
+   data_only = (match > 0);
+
+   ret = StateAction(st, stateversion, data_only);
+   FastLoad = false;
+
+   return ret;
+}
+
+static int SaveRaw_internal(StateMem *st, int data_only)
+{
+   uint8_t header[RAW_HEADER_SIZE];
+
+   memset(header, 0, sizeof(header));
+   smem_write(st, header, RAW_HEADER_SIZE);
+
+   SaveLayout = 14695981039346656037ULL;
+
+   RawMode = true;
+   if(!StateAction(st, 0, data_only))
+   {
+      RawMode = false;
+      return 0;
+   }
+   RawMode = false;
+
+   memcpy(header, RAW_MAGIC, 8);
+   MDFN_en32lsb(header + 8, MEDNAFEN_VERSION_NUMERIC);
+   MDFN_en32lsb(header + 12, sizeof(bool));
+   MDFN_en32lsb(header + 16, (uint32_t)SaveLayout);
+   MDFN_en32lsb(header + 20, (uint32_t)(SaveLayout >> 32));
+   MDFN_en32lsb(header + 24, st->len);
+
+   if(st->malloced >= RAW_HEADER_SIZE)
+      memcpy(st->data, header, RAW_HEADER_SIZE);
+
+   KnownLayout[data_only]      = SaveLayout;
+   KnownLayoutValid[data_only] = true;
+
+   return 1;
+}
+
+uint32_t MDFNSS_RawSize(int data_only)
+{
+   StateMem st;
+
+   st.data     = NULL;
+   st.loc      = 0;
+   st.len      = 0;
+   st.malloced = 0;
+   st.fixed    = true;
+
+   if(!SaveRaw_internal(&st, data_only != 0))
+      return 0;
+
+   return st.len;
+}
+
+uint32_t MDFNSS_SaveRaw(void *buf, uint32_t size, int data_only)
+{
+   StateMem st;
+
+   st.data     = (uint8_t *)buf;
+   st.loc      = 0;
+   st.len      = 0;
+   st.malloced = size;
+   st.fixed    = true;
+
+   if(!SaveRaw_internal(&st, data_only != 0) || st.len > size)
+      return 0;
+
+   return st.len;
+}
+
+int MDFNSS_LoadRaw(const void *buf, uint32_t size)
+{
+   const uint8_t *header = (const uint8_t *)buf;
+   uint64_t layout;
+   StateMem st;
+   int data_only;
+   int ret;
+
+   if(size < RAW_HEADER_SIZE || memcmp(header, RAW_MAGIC, 8))
+      return 0;
+
+   if(MDFN_de32lsb(header + 8) != MEDNAFEN_VERSION_NUMERIC
+         || MDFN_de32lsb(header + 12) != sizeof(bool)
+         || MDFN_de32lsb(header + 24) != size)
+      return 0;
+
+   layout = MDFN_de32lsb(header + 16) | ((uint64_t)MDFN_de32lsb(header + 20) << 32);
+
+   if((data_only = MatchLayout(layout)) < 0)
+      return 0;
+
+   st.data     = (uint8_t *)buf;
+   st.loc      = RAW_HEADER_SIZE;
+   st.len      = size;
+   st.malloced = 0;
+   st.fixed    = false;
+
+   RawMode = true;
+   ret = StateAction(&st, MEDNAFEN_VERSION_NUMERIC, data_only);
+   RawMode = false;
+
+   return ret && st.loc == size;
+}
+
+uint64_t MDFNSS_HashState(int data_only, MDFNSS_SectionHash *sections, unsigned max, unsigned *count)
+{
+   StateMem st;
+
+   memset(&st, 0, sizeof(st));
+
+   HashMode  = true;
+   HashOut   = sections;
+   HashMax   = sections ? max : 0;
+   HashCount = 0;
+   HashTotal = XXH_P5;
+
+   StateAction(&st, 0, data_only != 0);
+
+   HashMode = false;
+
+   if(count)
+      *count = HashCount;
+
+   return HashTotal;
+}
+
+void MDFNSS_LayoutChanged(void)
+{
+   KnownLayoutValid[0] = false;
+   KnownLayoutValid[1] = false;
+
+   /* Sized for the old layout's states */
+   free(PackBuf);
+   PackBuf     = NULL;
+   PackBufSize = 0;
 }
@@ -21,6 +21,9 @@ typedef struct
    uint32_t loc;
    uint32_t len;
    uint32_t malloced;
+   bool fixed;          /* data is a caller-owned buffer of 'malloced' bytes:
+                         * never reallocated, and writes that would overrun it
+                         * are dropped (loc/len still advance). */
 } StateMem;
 
 typedef struct
@@ -47,8 +50,50 @@ struct SSDescriptor
 extern "C" {
 #endif
 
-int MDFNSS_SaveSM(void *st, int a, int b, const void *c, const void *d, const void *e);
-int MDFNSS_LoadSM(void *st, int a, int b);
+/* data_only states are for run-ahead and rollback: they leave out the VIP
+ * framebuffers.  That is only safe while the game has the VIP redraw them
+ * every frame (VIP_RedrawsFB()); callers check before asking for one.
+ * Loads tell the two flavours apart on their own; what a data_only state
+ * lacks keeps its current contents. */
+int MDFNSS_SaveSM(void *st, int wantpreview, int data_only, const void *c, const void *d, const void *e);
+int MDFNSS_LoadSM(void *st, int haspreview, int data_only);
+
+/* Size in bytes of a state saved by MDFNSS_SaveSM(), without allocating. */
+uint32_t MDFNSS_SizeSM(int data_only);
+
+/* Call when the set or size of saved variables changes (e.g. a new game
+ * with a different GPRAM size), so loads stop trusting the cached layout. */
+void MDFNSS_LayoutChanged(void);
+
+/* Raw snapshots: every saved variable memcpy'd in native layout behind a
+ * small header, for in-process use such as run-ahead.  Loading refuses a
+ * snapshot from another core version or layout.  SaveRaw returns the number of
+ * bytes written, or 0 if 'size' is too small (see MDFNSS_RawSize). */
+uint32_t MDFNSS_RawSize(int data_only);
+uint32_t MDFNSS_SaveRaw(void *buf, uint32_t size, int data_only);
+int MDFNSS_LoadRaw(const void *buf, uint32_t size);
+
+/* Compressed states: a full MDFNSS_SaveSM() state in an LZ4 container,
+ * for storage.  MDFNSS_LoadSM() recognises and unpacks them itself and
+ * ignores anything after the container.  SaveCompressed returns the bytes
+ * written, or 0 if they don't fit in 'size'. */
+uint32_t MDFNSS_SaveCompressed(void *buf, uint32_t size);
+
+/* State hashes for tracking down desyncs, read straight from the SFORMAT
+ * tables without serialising: each field's saved bytes (little-endian,
+ * bools as bytes) are chained through XXH64, one chain per section (MAIN,
+ * V810, VSU, TIMER, INPUT, VIP), and the section hashes are combined into
+ * the returned one.  Up to 'max' sections are written to 'sections'
+ * (which may be NULL); 'count' gets how many there are.  Pass data_only
+ * to leave out what data_only states do, e.g. when peers load rollback
+ * states. */
+typedef struct
+{
+   char name[32];
+   uint64_t hash;
+} MDFNSS_SectionHash;
+
+uint64_t MDFNSS_HashState(int data_only, MDFNSS_SectionHash *sections, unsigned max, unsigned *count);
 
 int MDFNSS_StateAction(void *st, int load, int data_only, SFORMAT *sf, const char *name, bool optional);
 
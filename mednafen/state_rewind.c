@@ -0,0 +1,294 @@
+/* Mednafen - Multi-system Emulator
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <boolean.h>
+#include <retro_inline.h>
+
+#include "state.h"
+#include "state_rewind.h"
+
+/* Snapshots are compared as 32-bit words.  A delta is a sequence of
+ * (unchanged word count, changed word count, changed words XOR previous)
+ * records, the counts as LEB128 varints. */
+
+typedef struct
+{
+   uint8_t *data;
+   uint32_t len;
+   uint32_t cap;
+   uint32_t tag;
+} RewindEntry;
+
+static RewindEntry *Entries;
+static unsigned Depth;
+static unsigned Head;	/* Slot the next delta goes in */
+static unsigned Count;	/* Deltas held */
+
+static uint32_t *Latest;	/* Newest capture, in full */
+static uint32_t LatestTag;
+static uint32_t *Scratch;
+static uint8_t *Encoded;
+static uint32_t SnapSize;
+static uint32_t SnapWords;	/* SnapSize rounded up; the padding stays zero */
+static uint32_t EncodedCap;
+static bool HaveLatest;
+
+static uint64_t TotalCaptures;
+static uint64_t TotalStored;
+
+static INLINE uint8_t *PutVarint(uint8_t *out, uint32_t v)
+{
+   while(v >= 0x80)
+   {
+      *out++ = (v & 0x7F) | 0x80;
+      v >>= 7;
+   }
+   *out++ = v;
+
+   return out;
+}
+
+static INLINE const uint8_t *GetVarint(const uint8_t *in, uint32_t *v)
+{
+   uint32_t r = 0;
+   unsigned shift = 0;
+
+   do
+   {
+      r |= (uint32_t)(*in & 0x7F) << shift;
+      shift += 7;
+   } while(*in++ & 0x80);
+
+   *v = r;
+
+   return in;
+}
+
+static uint32_t EncodeDelta(uint8_t *out, const uint32_t *cur, const uint32_t *prev, uint32_t words)
+{
+   uint8_t *out_start = out;
+   uint32_t pos = 0;
+
+   while(pos < words)
+   {
+      uint32_t same_start = pos;
+      uint32_t lit_start;
+
+      while(pos < words && cur[pos] == prev[pos])
+         pos++;
+
+      lit_start = pos;
+      while(pos < words && cur[pos] != prev[pos])
+         pos++;
+
+      out = PutVarint(out, lit_start - same_start);
+      out = PutVarint(out, pos - lit_start);
+      for(; lit_start < pos; lit_start++)
+      {
+         uint32_t x = cur[lit_start] ^ prev[lit_start];
+
+         memcpy(out, &x, 4);
+         out += 4;
+      }
+   }
+
+   return out - out_start;
+}
+
+static void ApplyDelta(uint32_t *buf, const uint8_t *in, uint32_t len)
+{
+   const uint8_t *end = in + len;
+   uint32_t *p = buf;
+
+   while(in < end)
+   {
+      uint32_t same, lit;
+
+      in = GetVarint(in, &same);
+      in = GetVarint(in, &lit);
+
+      p += same;
+      while(lit--)
+      {
+         uint32_t x;
+
+         memcpy(&x, in, 4);
+         *p++ ^= x;
+         in += 4;
+      }
+   }
+}
+
+void MDFNSR_Kill(void)
+{
+   unsigned i;
+
+   if(Entries)
+   {
+      for(i = 0; i < Depth; i++)
+         free(Entries[i].data);
+      free(Entries);
+   }
+
+   free(Latest);
+   free(Scratch);
+   free(Encoded);
+
+   Entries    = NULL;
+   Latest     = NULL;
+   Scratch    = NULL;
+   Encoded    = NULL;
+   Depth      = 0;
+   Head       = 0;
+   Count      = 0;
+   SnapSize   = 0;
+   SnapWords  = 0;
+   EncodedCap = 0;
+   LatestTag  = 0;
+   HaveLatest = false;
+
+   TotalCaptures = 0;
+   TotalStored   = 0;
+}
+
+bool MDFNSR_Init(unsigned depth)
+{
+   MDFNSR_Kill();
+
+   if(!depth || !(SnapSize = MDFNSS_RawSize(0)))
+      return false;
+
+   SnapWords  = (SnapSize + 3) / 4;
+
+   /* Records alternate unchanged and changed runs, so at worst every
+    * other word is a record costing two one-byte counts. */
+   EncodedCap = SnapWords * 4 + SnapWords + 32;
+
+   Entries = (RewindEntry *)calloc(depth, sizeof(RewindEntry));
+   Latest  = (uint32_t *)calloc(SnapWords, 4);
+   Scratch = (uint32_t *)calloc(SnapWords, 4);
+   Encoded = (uint8_t *)malloc(EncodedCap);
+
+   if(!Entries || !Latest || !Scratch || !Encoded)
+   {
+      MDFNSR_Kill();
+      return false;
+   }
+
+   Depth = depth;
+
+   return true;
+}
+
+bool MDFNSR_Capture(void)
+{
+   RewindEntry *e;
+   uint32_t *tmp;
+   uint32_t len;
+
+   if(!Depth || MDFNSS_SaveRaw(Scratch, SnapSize, 0) != SnapSize)
+      return false;
+
+   TotalCaptures++;
+
+   if(!HaveLatest)
+   {
+      tmp        = Latest;
+      Latest     = Scratch;
+      Scratch    = tmp;
+      LatestTag  = 0;
+      HaveLatest = true;
+      return true;
+   }
+
+   len = EncodeDelta(Encoded, Scratch, Latest, SnapWords);
+
+   /* The oldest delta is overwritten once the ring is full. */
+   e = &Entries[Head];
+   if(e->cap < len)
+   {
+      uint8_t *data = (uint8_t *)realloc(e->data, len);
+
+      if(!data)
+         return false;
+
+      e->data = data;
+      e->cap  = len;
+   }
+   memcpy(e->data, Encoded, len);
+   e->len = len;
+   e->tag = LatestTag;
+
+   Head = (Head + 1) % Depth;
+   if(Count < Depth)
+      Count++;
+
+   tmp       = Latest;
+   Latest    = Scratch;
+   Scratch   = tmp;
+   LatestTag = 0;
+
+   TotalStored += len;
+
+   return true;
+}
+
+void MDFNSR_SetTag(uint32_t tag)
+{
+   LatestTag = tag;
+}
+
+bool MDFNSR_StepBack(uint32_t *tag)
+{
+   RewindEntry *e;
+
+   if(!HaveLatest || !MDFNSS_LoadRaw(Latest, SnapSize))
+      return false;
+
+   *tag = LatestTag;
+
+   if(!Count)
+   {
+      HaveLatest = false;
+      return true;
+   }
+
+   Head = (Head + Depth - 1) % Depth;
+   Count--;
+
+   e = &Entries[Head];
+   ApplyDelta(Latest, e->data, e->len);
+   LatestTag = e->tag;
+
+   return true;
+}
+
+unsigned MDFNSR_Count(void)
+{
+   return Count + (HaveLatest ? 1 : 0);
+}
+
+void MDFNSR_GetStats(uint64_t *captures, uint64_t *stored_bytes, uint32_t *snapshot_size)
+{
+   *captures      = TotalCaptures;
+   *stored_bytes  = TotalStored;
+   *snapshot_size = SnapSize;
+}
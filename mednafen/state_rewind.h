@@ -0,0 +1,37 @@
+#ifndef _STATE_REWIND_H
+#define _STATE_REWIND_H
+
+#include <stdint.h>
+#include <boolean.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* In-core rewind ring.  Each capture takes a raw snapshot (MDFNSS_SaveRaw)
+ * and stores it XORed against the previous one, run-length coded; only
+ * the newest snapshot is kept in full. */
+
+bool MDFNSR_Init(unsigned depth);	/* Depth in captures */
+void MDFNSR_Kill(void);
+
+bool MDFNSR_Capture(void);
+
+/* Each capture carries a word for the caller, set after it with
+ * MDFNSR_SetTag(); the libretro port keeps the frame's input there. */
+void MDFNSR_SetTag(uint32_t tag);
+
+/* Restores the most recent capture, hands back its tag and drops it
+ * from the ring. */
+bool MDFNSR_StepBack(uint32_t *tag);
+
+unsigned MDFNSR_Count(void);
+
+/* Totals since MDFNSR_Init(), for reporting. */
+void MDFNSR_GetStats(uint64_t *captures, uint64_t *stored_bytes, uint32_t *snapshot_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
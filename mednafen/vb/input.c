@@ -24,6 +24,11 @@
 
 static bool InstantReadHack;
 
+/* With late latching the pad state is fetched from the frontend at the
+ * first hardware read triggered in a frame rather than at frame start. */
+static bool LateLatch;
+static bool LatchPending;
+
 static bool IntPending;
 
 static uint8* data_ptr[2];
@@ -57,11 +62,26 @@ void VBINPUT_SetInstantReadHack(bool enabled)
    InstantReadHack = enabled;
 }
 
+void VBINPUT_SetLateLatch(bool enabled)
+{
+   LateLatch = enabled;
+}
+
 void VBINPUT_SetInput(int port, const char *type, void *ptr)
 {
    data_ptr[port] = (uint8 *)ptr;
 }
 
+/* SDR is filled in lazily on access, so the only event a read needs is
+ * the completion interrupt after the last bit. */
+static INLINE v810_timestamp_t NextEventTS(const v810_timestamp_t timestamp)
+{
+   if(ReadCounter <= 0)
+      return VB_EVENT_NONONO;
+
+   return timestamp + ReadCounter + 640 * (15 - ReadBitPos);
+}
+
 uint8 VBINPUT_Read(v810_timestamp_t timestamp, uint32 A)
 {
    uint8_t ret = 0;
@@ -89,11 +109,21 @@ uint8 VBINPUT_Read(v810_timestamp_t timestamp, uint32 A)
          break;
    }
 
-   VB_SetEvent(VB_EVENT_INPUT, (ReadCounter > 0) ? (timestamp + ReadCounter) : VB_EVENT_NONONO);
+   VB_SetEvent(VB_EVENT_INPUT, NextEventTS(timestamp));
 
    return(ret);
 }
 
+static INLINE uint16_t MDFN_de16lsb(const uint8_t *morp)
+{
+   return(morp[0] | (morp[1] << 8));
+}
+
+static void LatchPadData(void)
+{
+   PadData = (MDFN_de16lsb(data_ptr[0]) << 2) | 0x2 | (*data_ptr[1] & 0x1);
+}
+
 void VBINPUT_Write(v810_timestamp_t timestamp, uint32 A, uint8 V)
 {
    VBINPUT_Update(timestamp);
@@ -103,6 +133,13 @@ void VBINPUT_Write(v810_timestamp_t timestamp, uint32 A, uint8 V)
       case 0x28:
          if((V & SCR_HW_SI) && !(SCR & SCR_S_ABT_DIS) && ReadCounter <= 0)
          {
+            if(LatchPending)
+            {
+               LatchPending = false;
+               VB_LatchInput();
+               LatchPadData();
+            }
+
             PadLatched = PadData;
             ReadBitPos = 0;
             ReadCounter = 640;
@@ -124,17 +161,15 @@ void VBINPUT_Write(v810_timestamp_t timestamp, uint32 A, uint8 V)
          break;
    }
 
-   VB_SetEvent(VB_EVENT_INPUT, (ReadCounter > 0) ? (timestamp + ReadCounter) : VB_EVENT_NONONO);
-}
-
-static INLINE uint16_t MDFN_de16lsb(const uint8_t *morp)
-{
-   return(morp[0] | (morp[1] << 8));
+   VB_SetEvent(VB_EVENT_INPUT, NextEventTS(timestamp));
 }
 
 void VBINPUT_Frame(void)
 {
-   PadData = (MDFN_de16lsb(data_ptr[0]) << 2) | 0x2 | (*data_ptr[1] & 0x1);
+   if(LateLatch)
+      LatchPending = true;
+   else
+      LatchPadData();
 }
 
 v810_timestamp_t VBINPUT_Update(const v810_timestamp_t timestamp)
@@ -145,31 +180,37 @@ v810_timestamp_t VBINPUT_Update(const v810_timestamp_t timestamp)
    {
       ReadCounter -= clocks;
 
-      while(ReadCounter <= 0)
+      if(ReadCounter <= 0)
       {
-         SDR &= ~(1 << ReadBitPos);
-         SDR |= PadLatched & (1 << ReadBitPos);
+         /* Shift in every bit whose 640-cycle slot has elapsed at once. */
+         uint32 bits = 1 + (uint32)(-ReadCounter) / 640;
+         uint32 mask;
+
+         if(bits > 16 - ReadBitPos)
+            bits = 16 - ReadBitPos;
+
+         mask = ((1U << bits) - 1) << ReadBitPos;
+         SDR = (SDR & ~mask) | (PadLatched & mask);
 
-         ReadBitPos++;
+         ReadBitPos += bits;
          if(ReadBitPos < 16)
-            ReadCounter += 640;
+            ReadCounter += 640 * bits;
          else
          {
+            ReadCounter += 640 * (bits - 1);
+
             if(!(SCR & SCR_K_INT_INH))
             {
                IntPending = true;
                VBIRQ_Assert(VBIRQ_SOURCE_INPUT, IntPending);
             }
-            break;
          }
       }
-
    }
 
-
    last_ts = timestamp;
 
-   return((ReadCounter > 0) ? (timestamp + ReadCounter) : VB_EVENT_NONONO);
+   return NextEventTS(timestamp);
 }
 
 void VBINPUT_ResetTS(void)
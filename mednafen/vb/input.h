@@ -11,6 +11,7 @@ extern "C" {
 
 void VBINPUT_Init(void);
 void VBINPUT_SetInstantReadHack(bool);
+void VBINPUT_SetLateLatch(bool);
 
 void VBINPUT_SetInput(int port, const char *type, void *ptr);
 
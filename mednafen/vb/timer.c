@@ -34,37 +34,105 @@ static v810_timestamp_t TimerLastTS;
 static bool TimerStatus, TimerStatusShadow;
 static bool ReloadPending;
 
-v810_timestamp_t TIMER_Update(v810_timestamp_t timestamp)
+#define TIMER_PERIOD() ((TimerControl & TC_TCLKSEL) ? 400 : 2000)
+
+/* One tick of the 16-bit counter. */
+static INLINE void TimerTick(void)
 {
-   int32 run_time = timestamp - TimerLastTS;
+   if(!TimerCounter || ReloadPending)
+   {
+      TimerCounter = TimerReloadValue;
+      ReloadPending = false;
+   }
 
-   if(TimerControl & TC_TENABLE)
+   if(TimerCounter)
+      TimerCounter--;
+
+   if(!TimerCounter || TimerStatus)
    {
-      TimerDivider -= run_time;
-      while(TimerDivider <= 0)
+      TimerStatusShadow = TimerStatus = true;
+   }
+}
+
+/* Equivalent to calling TimerTick() 'ticks' times.  After the first
+ * tick no reload is pending, so the counter just counts down to zero
+ * and then repeats with a period of TimerReloadValue ticks. */
+static void TimerRunTicks(int32 ticks)
+{
+   TimerTick();
+   ticks--;
+
+   while(ticks > 0)
+   {
+      if(TimerCounter)
       {
-         if(!TimerCounter || ReloadPending)
-         {
-            TimerCounter = TimerReloadValue;
-            ReloadPending = false;
-         }
+         int32 n = (ticks < TimerCounter) ? ticks : TimerCounter;
 
-         if(TimerCounter)
-            TimerCounter--;
+         TimerCounter -= n;
+         ticks -= n;
 
          if(!TimerCounter || TimerStatus)
-         {
             TimerStatusShadow = TimerStatus = true;
+      }
+      else
+      {
+         if(TimerReloadValue)
+            ticks %= TimerReloadValue;
+         else
+            ticks = 1;	/* Stays at zero with the status set. */
+
+         if(ticks)
+         {
+            TimerTick();
+            ticks--;
          }
+      }
+   }
+}
+
+/* The only thing the rest of the system can't observe lazily through
+ * TIMER_Read() is the interrupt line, so an event is only needed for
+ * the tick that raises it. */
+static v810_timestamp_t TimerNextEventTS(v810_timestamp_t timestamp)
+{
+   int32 ticks = 1;
+
+   if(!(TimerControl & TC_TENABLE) || !(TimerControl & TC_TIMZINT) || TimerStatusShadow)
+      return VB_EVENT_NONONO;
+
+   if(!TimerStatus)
+   {
+      int32 counter = (!TimerCounter || ReloadPending) ? TimerReloadValue : TimerCounter;
+
+      if(counter > 1)
+         ticks = counter;
+   }
+
+   return timestamp + TimerDivider + (ticks - 1) * TIMER_PERIOD();
+}
+
+v810_timestamp_t TIMER_Update(v810_timestamp_t timestamp)
+{
+   int32 run_time = timestamp - TimerLastTS;
+
+   if(TimerControl & TC_TENABLE)
+   {
+      TimerDivider -= run_time;
+      if(TimerDivider <= 0)
+      {
+         const int32 period = TIMER_PERIOD();
+         const int32 ticks = 1 + (-TimerDivider) / period;
+
+         TimerRunTicks(ticks);
+         TimerDivider += ticks * period;
 
          VBIRQ_Assert(VBIRQ_SOURCE_TIMER, TimerStatusShadow && (TimerControl & TC_TIMZINT));
-         TimerDivider += (TimerControl & TC_TCLKSEL) ? 400 : 2000;
       }
    }
 
    TimerLastTS = timestamp;
 
-   return((TimerControl & TC_TENABLE) ? (timestamp + TimerDivider) : VB_EVENT_NONONO);
+   return TimerNextEventTS(timestamp);
 }
 
 void TIMER_ResetTS(void)
@@ -127,11 +195,11 @@ void TIMER_Write(const v810_timestamp_t timestamp, uint32 A, uint8 V)
             TimerStatus = TimerStatusShadow = false;
 
          VBIRQ_Assert(VBIRQ_SOURCE_TIMER, TimerStatusShadow && (TimerControl & TC_TIMZINT));
-
-         if(TimerControl & TC_TENABLE)
-            VB_SetEvent(VB_EVENT_TIMER, timestamp + TimerDivider);
          break;
    }
+
+   /* Reload, status and control writes all move the interrupt tick. */
+   VB_SetEvent(VB_EVENT_TIMER, TimerNextEventTS(timestamp));
 }
 
 void TIMER_Power(void)
@@ -206,4 +274,8 @@ void TIMER_SetRegister(const unsigned int id, const uint32 value)
          break;
 
    }
+
+   /* As for a bus write; the timer's state is current as of TimerLastTS. */
+   VBIRQ_Assert(VBIRQ_SOURCE_TIMER, TimerStatusShadow && (TimerControl & TC_TIMZINT));
+   VB_SetEvent(VB_EVENT_TIMER, TimerNextEventTS(TimerLastTS));
 }
@@ -2,6 +2,7 @@
 #define __VB_VB_H
 
 #include <boolean.h>
+#include <retro_inline.h>
 
 enum
 {
@@ -31,6 +32,15 @@ enum
 #define VBIRQ_SOURCE_COMM       3
 #define VBIRQ_SOURCE_VIP        4
 
+/* Dirty page tracking, 256-byte pages.  All regions share one bitmap;
+ * each region's pages start at its VB_DIRTY_*_BASE. */
+#define VB_DIRTY_PAGE_SHIFT   8
+#define VB_DIRTY_WRAM_BASE    0	/* 64KiB */
+#define VB_DIRTY_GPRAM_BASE   256	/* 64KiB */
+#define VB_DIRTY_DRAM_BASE    512	/* 128KiB */
+#define VB_DIRTY_CHR_RAM_BASE 1024	/* 32KiB */
+#define VB_DIRTY_PAGES        1152
+
 #include "../mednafen-types.h"
 
 #ifdef __cplusplus
@@ -39,10 +49,33 @@ extern "C" {
 
 void VB_SetEvent(const int type, const v810_timestamp_t next_timestamp);
 
+extern bool VB_DirtyTracking;
+extern uint32 VB_DirtyBits[VB_DIRTY_PAGES / 32];
+
+/* Offset is in bytes from the start of the region. */
+static INLINE void VB_MarkDirty(const uint32 base, const uint32 offset)
+{
+   const uint32 page = base + (offset >> VB_DIRTY_PAGE_SHIFT);
+
+   VB_DirtyBits[page >> 5] |= 1U << (page & 31);
+}
+
+void VB_SetDirtyTracking(bool enabled);
+
+/* Pages written during the last emulated frame, one bit per page
+ * (bit n of word n / 32 for page n); NULL when tracking is off. */
+const uint32 *VB_GetDirtyPages(void);
+
 void VBIRQ_Assert(int source, bool assert);
 
 void VB_ExitLoop(void);
 
+/* Late input latching: refresh the pad data before it is first read. */
+void VB_LatchInput(void);
+
+/* Called by the VIP when it enters display region 1, 2 or 3 of a frame. */
+void VB_DisplayRegionBoundary(const v810_timestamp_t timestamp, const int region);
+
 #ifdef __cplusplus
 }
 #endif
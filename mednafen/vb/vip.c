@@ -16,6 +16,7 @@
  */
 
 #include <math.h>
+#include <stdlib.h>
 
 #include <retro_inline.h>
 
@@ -77,24 +78,45 @@ static uint16 InterruptEnable;
 static uint8 BRTA, BRTB, BRTC, REST;
 static uint8 Repeat;
 
-static void CopyFBColumnToTarget_Anaglyph(void) NO_INLINE;
-static void CopyFBColumnToTarget_AnaglyphSlow(void) NO_INLINE;
-static void CopyFBColumnToTarget_CScope(void) NO_INLINE;
-static void CopyFBColumnToTarget_SideBySide(void) NO_INLINE;
-static void CopyFBColumnToTarget_VLI(void) NO_INLINE;
-static void CopyFBColumnToTarget_HLI(void) NO_INLINE;
-static void (*CopyFBColumnToTarget)(void) = NULL;
+/* Convert "count" framebuffer columns of eye "lr", starting at "column",
+ * to the output surface using the current brightness cache. */
+static void CopyFBColumnsToTarget_Anaglyph(const int lr, int32 column, int32 count) NO_INLINE;
+static void CopyFBColumnsToTarget_AnaglyphSlow(const int lr, int32 column, int32 count) NO_INLINE;
+static void CopyFBColumnsToTarget_CScope(const int lr, int32 column, int32 count) NO_INLINE;
+static void CopyFBColumnsToTarget_SideBySide(const int lr, int32 column, int32 count) NO_INLINE;
+static void CopyFBColumnsToTarget_VLI(const int lr, int32 column, int32 count) NO_INLINE;
+static void CopyFBColumnsToTarget_HLI(const int lr, int32 column, int32 count) NO_INLINE;
+static void (*CopyFBColumnsToTarget)(const int lr, int32 column, int32 count) = NULL;
 static uint32 VB3DMode;
 static uint32 VB3DReverse;
 static uint32 VBPrescale;
 static uint32 VBSBS_Separation;
-static uint32 HLILUT[256];
 static uint32 ColorLUT[2][256];
 static int32 BrightnessCache[4];
 static uint32 BrightCLUT[2][4];
 
-static double ColorLUTNoGC[2][256][3];
-static uint32 AnaSlowColorLUT[256][256];
+/* Column table of each eye, compressed into runs of columns sharing the
+ * same repeat count, each carrying its own brightness lookup tables.
+ * Rebuilt by ConvertFrame() only when the column table or the brightness
+ * registers change. */
+typedef struct
+{
+   int16 start;
+   int16 length;
+   uint8 repeat;
+   int32 bright[4];
+   uint32 clut[2][4];
+} BrightRun;
+
+static BrightRun BrightRuns[2][384 / 4];
+static unsigned BrightRunCount[2];
+static bool BrightRunsDirty;
+
+/* Buffers only needed by some 3D modes; (re)allocated by Recalc3DModeStuff(),
+ * NULL while the current mode doesn't use them. */
+static uint32 *HLILUT;                  /* [256], HLI */
+static uint32 (*AnaSlowBuf)[224];       /* [384][224], slow anaglyph */
+static uint32 (*AnaSlowColorLUT)[256];  /* [256][256], slow anaglyph */
 
 /* A few settings: */
 static bool InstantDisplayHack;
@@ -105,9 +127,15 @@ static bool ParallaxDisabled;
 static uint32 Anaglyph_Colors[2];
 static uint32 Default_Color;
 
-static void MakeColorLUT(void)
+/* Returns false if AnaSlowColorLUT is allocated but couldn't be filled in
+ * (no memory for the intermediate table). */
+static bool MakeColorLUT(void)
 {
    unsigned lr, i, l_b, r_b;
+   double (*ColorLUTNoGC)[256][3] = NULL;
+
+   if(AnaSlowColorLUT)
+      ColorLUTNoGC = (double (*)[256][3])malloc(sizeof(double) * 2 * 256 * 3);
 
    for(lr = 0; lr < 2; lr++)
    {
@@ -135,14 +163,21 @@ static void MakeColorLUT(void)
                b_prime = b_prime * ((Default_Color >> 0) & 0xFF) / 255;
                break;
          }
-         ColorLUTNoGC[lr][i][0] = pow(r_prime, 2.2 / 1.0);
-         ColorLUTNoGC[lr][i][1] = pow(g_prime, 2.2 / 1.0);
-         ColorLUTNoGC[lr][i][2] = pow(b_prime, 2.2 / 1.0);
+
+         if(ColorLUTNoGC)
+         {
+            ColorLUTNoGC[lr][i][0] = pow(r_prime, 2.2 / 1.0);
+            ColorLUTNoGC[lr][i][1] = pow(g_prime, 2.2 / 1.0);
+            ColorLUTNoGC[lr][i][2] = pow(b_prime, 2.2 / 1.0);
+         }
 
          ColorLUT[lr][i] = MAKECOLOR((int)(r_prime * 255), (int)(g_prime * 255), (int)(b_prime * 255), 0);
       }
    }
 
+   if(!ColorLUTNoGC)
+      return !AnaSlowColorLUT;
+
    /* Anaglyph slow-mode LUT calculation */
    for(l_b = 0; l_b < 256; l_b++)
    {
@@ -167,9 +202,13 @@ static void MakeColorLUT(void)
          AnaSlowColorLUT[l_b][r_b] = MAKECOLOR(((int)(r_prime * 255)), ((int)(g_prime * 255)), ((int)(b_prime * 255)), 0);
       }
    }
+
+   free(ColorLUTNoGC);
+
+   return true;
 }
 
-static void RecalcBrightnessCache(void)
+static void CalcBrightnessCache(const uint8 repeat)
 {
    unsigned i, lr;
    int32 CumulativeTime = (BRTA + 1 + BRTB + 1 + BRTC + 1 + REST + 1) + 1;
@@ -180,7 +219,7 @@ static void RecalcBrightnessCache(void)
    BrightnessCache[2] = 0;
    BrightnessCache[3] = 0;
 
-   for(i = 0; i < Repeat + 1; i++)
+   for(i = 0; i < (unsigned)repeat + 1; i++)
    {
       int32 btemp[4];
 
@@ -222,71 +261,137 @@ static void RecalcBrightnessCache(void)
          BrightCLUT[lr][i] = ColorLUT[lr][BrightnessCache[i]];
 }
 
+static void RecalcBrightnessCache(void)
+{
+   CalcBrightnessCache(Repeat);
+   BrightRunsDirty = true;
+}
+
+static void FreeModeBuffers(bool hli, bool ana_slow)
+{
+   if(!hli && HLILUT)
+   {
+      free(HLILUT);
+      HLILUT = NULL;
+   }
+
+   if(!ana_slow && AnaSlowBuf)
+   {
+      free(AnaSlowBuf);
+      AnaSlowBuf = NULL;
+   }
+
+   if(!ana_slow && AnaSlowColorLUT)
+   {
+      free(AnaSlowColorLUT);
+      AnaSlowColorLUT = NULL;
+   }
+}
+
+static void MakeHLILUT(void)
+{
+   uint32_t p;
+
+   for(p = 0; p < 256; p++)
+   {
+      unsigned i, ps, shifty;
+      uint8 s[4];
+      uint32 v   = 0;
+
+      s[0] = (p >> 0) & 0x3;
+      s[1] = (p >> 2) & 0x3;
+      s[2] = (p >> 4) & 0x3;
+      s[3] = (p >> 6) & 0x3;
+
+      for(i = 0, shifty = 0; i < 4; i++)
+      {
+         for(ps = 0; ps < VBPrescale; ps++)
+         {
+            v |= s[i] << shifty;
+            shifty += 2;
+         }
+      }
+
+      HLILUT[p] = v;
+   }
+}
+
 static void Recalc3DModeStuff(bool non_rgb_output)
 {
+   bool hli      = false;
+   bool ana_slow = false;
+
    switch(VB3DMode)
    {
       default: 
-         CopyFBColumnToTarget = CopyFBColumnToTarget_Anaglyph;
+         CopyFBColumnsToTarget = CopyFBColumnsToTarget_Anaglyph;
          if(((Anaglyph_Colors[0] & 0xFF) && (Anaglyph_Colors[1] & 0xFF)) ||
                ((Anaglyph_Colors[0] & 0xFF00) && (Anaglyph_Colors[1] & 0xFF00)) ||
                ((Anaglyph_Colors[0] & 0xFF0000) && (Anaglyph_Colors[1] & 0xFF0000)) ||
                non_rgb_output)
-            CopyFBColumnToTarget = CopyFBColumnToTarget_AnaglyphSlow;
+            ana_slow = true;
          break;
 
       case VB3DMODE_CSCOPE:
-         CopyFBColumnToTarget = CopyFBColumnToTarget_CScope;
+         CopyFBColumnsToTarget = CopyFBColumnsToTarget_CScope;
          break;
 
       case VB3DMODE_SIDEBYSIDE:
-         CopyFBColumnToTarget = CopyFBColumnToTarget_SideBySide;
+         CopyFBColumnsToTarget = CopyFBColumnsToTarget_SideBySide;
          break;
 
       case VB3DMODE_VLI:
-         CopyFBColumnToTarget = CopyFBColumnToTarget_VLI;
+         CopyFBColumnsToTarget = CopyFBColumnsToTarget_VLI;
          break;
 
       case VB3DMODE_HLI:
-         CopyFBColumnToTarget = CopyFBColumnToTarget_HLI;
+         CopyFBColumnsToTarget = CopyFBColumnsToTarget_HLI;
+         hli = true;
          break;
    }
+
+   FreeModeBuffers(hli, ana_slow);
+
+   /* HLI falls back to its LUT-less loop, and slow anaglyph
+    * to the plain anaglyph path, if allocation fails. */
+   if(hli)
+   {
+      if(!HLILUT)
+         HLILUT = (uint32 *)malloc(256 * sizeof(uint32));
+      if(HLILUT)
+         MakeHLILUT();
+   }
+
+   if(ana_slow)
+   {
+      if(!AnaSlowBuf)
+         AnaSlowBuf = (uint32 (*)[224])malloc(384 * 224 * sizeof(uint32));
+      if(!AnaSlowColorLUT)
+         AnaSlowColorLUT = (uint32 (*)[256])malloc(256 * 256 * sizeof(uint32));
+
+      if(AnaSlowBuf && AnaSlowColorLUT)
+         CopyFBColumnsToTarget = CopyFBColumnsToTarget_AnaglyphSlow;
+      else
+         FreeModeBuffers(hli, false);
+   }
+
+   if(!MakeColorLUT())
+   {
+      FreeModeBuffers(hli, false);
+      CopyFBColumnsToTarget = CopyFBColumnsToTarget_Anaglyph;
+   }
+
    RecalcBrightnessCache();
 }
 
 void VIP_Set3DMode(uint32 mode, bool reverse, uint32 prescale, uint32 sbs_separation)
 {
-   uint32_t p;
-
    VB3DMode         = mode;
    VB3DReverse      = reverse ? 1 : 0;
    VBPrescale       = prescale;
    VBSBS_Separation = sbs_separation;
 
    VidSettingsDirty = true;
-
-   for(p = 0; p < 256; p++)
-   {
-      unsigned i, ps, shifty;
-      uint8 s[4];
-      uint32 v   = 0;
-
-      s[0] = (p >> 0) & 0x3;
-      s[1] = (p >> 2) & 0x3;
-      s[2] = (p >> 4) & 0x3;
-      s[3] = (p >> 6) & 0x3;
-
-      for(i = 0, shifty = 0; i < 4; i++)
-      {
-         for(ps = 0; ps < prescale; ps++)
-         {
-            v |= s[i] << shifty;
-            shifty += 2;
-         }
-      }
-
-      HLILUT[p] = v;
-   }
 }
 
 void VIP_SetParallaxDisable(bool disabled)
@@ -396,6 +501,25 @@ bool VIP_Init(void)
    return(true);
 }
 
+void VIP_Kill(void)
+{
+   FreeModeBuffers(false, false);
+}
+
+uint32 VIP_GetMemoryUsage(void)
+{
+   uint32 ret = sizeof(FB) + sizeof(CHR_RAM) + sizeof(DRAM) + sizeof(ColorLUT) + sizeof(BrightRuns);
+
+   if(HLILUT)
+      ret += 256 * sizeof(uint32);
+   if(AnaSlowBuf)
+      ret += 384 * 224 * sizeof(uint32);
+   if(AnaSlowColorLUT)
+      ret += 256 * 256 * sizeof(uint32);
+
+   return ret;
+}
+
 void VIP_Power(void)
 {
    unsigned i;
@@ -451,6 +575,8 @@ void VIP_Power(void)
    }
 
    BKCOL = 0;
+
+   BrightRunsDirty = true;
 }
 
 static INLINE uint16 ReadRegister(int32 timestamp, uint32 A)
@@ -729,7 +855,11 @@ void VIP_Write8(int32 timestamp, uint32 A, uint8 V)
       case 0x0:
       case 0x1:
          if((A & 0x7FFF) >= 0x6000)
+         {
             VIP_MA16W8(CHR_RAM, (A & 0x1FFF) | ((A >> 2) & 0x6000), V);
+            if(VB_DirtyTracking)
+               VB_MarkDirty(VB_DIRTY_CHR_RAM_BASE, (A & 0x1FFF) | ((A >> 2) & 0x6000));
+         }
          else
             FB[(A >> 15) & 1][(A >> 16) & 1][A & 0x7FFF] = V;
          break;
@@ -737,6 +867,10 @@ void VIP_Write8(int32 timestamp, uint32 A, uint8 V)
       case 0x2:
       case 0x3:
          VIP_MA16W8(DRAM, A & 0x1FFFF, V);
+         if(VB_DirtyTracking)
+            VB_MarkDirty(VB_DIRTY_DRAM_BASE, A & 0x1FFFF);
+         if((A & 0x1FC00) == 0x1DC00)	/* Column tables */
+            BrightRunsDirty = true;
          break;
 
       case 0x4:
@@ -750,7 +884,11 @@ void VIP_Write8(int32 timestamp, uint32 A, uint8 V)
 
       case 0x7:
          if(A >= 0x8000)
+         {
             VIP_MA16W8(CHR_RAM, A & 0x7FFF, V);
+            if(VB_DirtyTracking)
+               VB_MarkDirty(VB_DIRTY_CHR_RAM_BASE, A & 0x7FFF);
+         }
          break;
    }
 }
@@ -762,7 +900,11 @@ void VIP_Write16(int32 timestamp, uint32 A, uint16 V)
       case 0x0:
       case 0x1:
          if((A & 0x7FFF) >= 0x6000)
+         {
             VIP_MA16W16(CHR_RAM, (A & 0x1FFF) | ((A >> 2) & 0x6000), V);
+            if(VB_DirtyTracking)
+               VB_MarkDirty(VB_DIRTY_CHR_RAM_BASE, (A & 0x1FFF) | ((A >> 2) & 0x6000));
+         }
          else
             StoreU16_LE((uint16 *)&FB[(A >> 15) & 1][(A >> 16) & 1][A & 0x7FFF], V);
          break;
@@ -770,6 +912,10 @@ void VIP_Write16(int32 timestamp, uint32 A, uint16 V)
       case 0x2:
       case 0x3:
          VIP_MA16W16(DRAM, A & 0x1FFFF, V);
+         if(VB_DirtyTracking)
+            VB_MarkDirty(VB_DIRTY_DRAM_BASE, A & 0x1FFFF);
+         if((A & 0x1FC00) == 0x1DC00)	/* Column tables */
+            BrightRunsDirty = true;
          break;
       case 0x4:
       case 0x5:
@@ -780,21 +926,23 @@ void VIP_Write16(int32 timestamp, uint32 A, uint16 V)
          break;
       case 0x7:
          if(A >= 0x8000)
+         {
             VIP_MA16W16(CHR_RAM, A & 0x7FFF, V);
+            if(VB_DirtyTracking)
+               VB_MarkDirty(VB_DIRTY_CHR_RAM_BASE, A & 0x7FFF);
+         }
          break;
    }
 }
 
 static struct MDFN_Surface *surface;
 static bool skip;
+static bool skip_convert;	/* Set whenever skip is */
 
 void VIP_StartFrame(EmulateSpecStruct *espec)
 {
    if(espec->VideoFormatChanged || VidSettingsDirty)
-   {
-      MakeColorLUT();
       Recalc3DModeStuff(espec->surface->format.colorspace != MDFN_COLORSPACE_RGB);
-   }
 
    espec->DisplayRect.x = 0;
    espec->DisplayRect.y = 0;
@@ -827,8 +975,9 @@ void VIP_StartFrame(EmulateSpecStruct *espec)
          break;
    }
 
-   surface = espec->surface;
-   skip    = false;
+   surface      = espec->surface;
+   skip         = espec->skip;
+   skip_convert = espec->skip || espec->skip_convert;
    
    if(VidSettingsDirty)
    {
@@ -851,20 +1000,20 @@ void VIP_ResetTS(void)
 
 #include "vip_draw.inc"
 
-static INLINE void CopyFBColumnToTarget_Anaglyph_BASE(const bool DisplayActive_arg, const int lr)
+static INLINE void CopyFBColumnToTarget_Anaglyph_BASE(const bool DisplayActive_arg, const int lr, const int32 column)
 {
    int y, y_sub;
    const int fb = DisplayFB;
 
 #if defined(WANT_8BPP)
-   uint8  *target = surface->pixels8  + Column;
+   uint8  *target = surface->pixels8  + column;
 #elif defined(WANT_16BPP)
-   uint16 *target = surface->pixels16 + Column;
+   uint16 *target = surface->pixels16 + column;
 #else
-   uint32 *target = surface->pixels   + Column;
+   uint32 *target = surface->pixels   + column;
 #endif
    const int32 pitchinpix = surface->pitchinpix;
-   const uint8 *fb_source = &FB[fb][lr][64 * Column];
+   const uint8 *fb_source = &FB[fb][lr][64 * column];
 
    if (DisplayActive_arg)
    {
@@ -932,26 +1081,28 @@ static INLINE void CopyFBColumnToTarget_Anaglyph_BASE(const bool DisplayActive_a
    }
 }
 
-static void CopyFBColumnToTarget_Anaglyph(void)
+static void CopyFBColumnsToTarget_Anaglyph(const int lr, int32 column, int32 count)
 {
-   const int lr = (DisplayRegion & 2) >> 1;
-
    if(!lr)
-      CopyFBColumnToTarget_Anaglyph_BASE(DisplayActive, 0);
+   {
+      for(; count > 0; count--, column++)
+         CopyFBColumnToTarget_Anaglyph_BASE(DisplayActive, 0, column);
+   }
    else
-      CopyFBColumnToTarget_Anaglyph_BASE(DisplayActive, 1);
+   {
+      for(; count > 0; count--, column++)
+         CopyFBColumnToTarget_Anaglyph_BASE(DisplayActive, 1, column);
+   }
 }
 
-static uint32 AnaSlowBuf[384][224];
-
-static INLINE void CopyFBColumnToTarget_AnaglyphSlow_BASE(const bool DisplayActive_arg, const int lr)
+static INLINE void CopyFBColumnToTarget_AnaglyphSlow_BASE(const bool DisplayActive_arg, const int lr, const int32 column)
 {
    const int fb = DisplayFB;
-   const uint8 *fb_source = &FB[fb][lr][64 * Column];
+   const uint8 *fb_source = &FB[fb][lr][64 * column];
 
    if(!lr)
    {
-      uint32 *target = AnaSlowBuf[Column];
+      uint32 *target = AnaSlowBuf[column];
 
       if (DisplayActive_arg)
       {
@@ -990,8 +1141,8 @@ static INLINE void CopyFBColumnToTarget_AnaglyphSlow_BASE(const bool DisplayActi
    else
    {
       int y;
-      uint32         *target = surface->pixels + Column;
-      const uint32 *left_src = AnaSlowBuf[Column];
+      uint32         *target = surface->pixels + column;
+      const uint32 *left_src = AnaSlowBuf[column];
       const int32    pitch32 = surface->pitch32;
 
       for(y = 56; y; y--)
@@ -1016,25 +1167,36 @@ static INLINE void CopyFBColumnToTarget_AnaglyphSlow_BASE(const bool DisplayActi
    }
 }
 
-static void CopyFBColumnToTarget_AnaglyphSlow(void)
+static void CopyFBColumnsToTarget_AnaglyphSlow(const int lr, int32 column, int32 count)
 {
-   const int lr = (DisplayRegion & 2) >> 1;
+   /* Only selected with both buffers built, but never index a missing one */
+   if(MDFN_UNLIKELY(!AnaSlowBuf || !AnaSlowColorLUT))
+   {
+      CopyFBColumnsToTarget_Anaglyph(lr, column, count);
+      return;
+   }
 
    if(!lr)
-      CopyFBColumnToTarget_AnaglyphSlow_BASE(DisplayActive, 0);
+   {
+      for(; count > 0; count--, column++)
+         CopyFBColumnToTarget_AnaglyphSlow_BASE(DisplayActive, 0, column);
+   }
    else
-      CopyFBColumnToTarget_AnaglyphSlow_BASE(DisplayActive, 1);
+   {
+      for(; count > 0; count--, column++)
+         CopyFBColumnToTarget_AnaglyphSlow_BASE(DisplayActive, 1, column);
+   }
 }
 
-static void CopyFBColumnToTarget_CScope_BASE(const bool DisplayActive_arg, const int lr, const int dest_lr)
+static void CopyFBColumnToTarget_CScope_BASE(const bool DisplayActive_arg, const int lr, const int dest_lr, const int32 column)
 {
    int y, y_sub;
    const int fb = DisplayFB;
-   const uint8 *fb_source = &FB[fb][lr][64 * Column];
+   const uint8 *fb_source = &FB[fb][lr][64 * column];
 
    if(dest_lr)
    {
-      uint32 *target = surface->pixels + (512 - 16 - 1) + (Column) 
+      uint32 *target = surface->pixels + (512 - 16 - 1) + (column) 
          * surface->pitch32;
       if(DisplayActive_arg)
       {
@@ -1066,7 +1228,7 @@ static void CopyFBColumnToTarget_CScope_BASE(const bool DisplayActive_arg, const
    }
    else
    {
-      uint32 *target = surface->pixels + 16 + (383 - Column) * surface->pitch32;
+      uint32 *target = surface->pixels + 16 + (383 - column) * surface->pitch32;
       if(DisplayActive_arg)
       {
          for(y = 56; y; y--)
@@ -1097,22 +1259,26 @@ static void CopyFBColumnToTarget_CScope_BASE(const bool DisplayActive_arg, const
    }
 }
 
-static void CopyFBColumnToTarget_CScope(void)
+static void CopyFBColumnsToTarget_CScope(const int lr, int32 column, int32 count)
 {
-   const int lr = (DisplayRegion & 2) >> 1;
-
    if(!lr)
-      CopyFBColumnToTarget_CScope_BASE(DisplayActive, 0, 0 ^ VB3DReverse);
+   {
+      for(; count > 0; count--, column++)
+         CopyFBColumnToTarget_CScope_BASE(DisplayActive, 0, 0 ^ VB3DReverse, column);
+   }
    else
-      CopyFBColumnToTarget_CScope_BASE(DisplayActive, 1, 1 ^ VB3DReverse);
+   {
+      for(; count > 0; count--, column++)
+         CopyFBColumnToTarget_CScope_BASE(DisplayActive, 1, 1 ^ VB3DReverse, column);
+   }
 }
 
-static void CopyFBColumnToTarget_SideBySide_BASE(const bool DisplayActive_arg, const int lr, const int dest_lr)
+static void CopyFBColumnToTarget_SideBySide_BASE(const bool DisplayActive_arg, const int lr, const int dest_lr, const int32 column)
 {
    const int fb = DisplayFB;
-   uint32 *target = surface->pixels + Column + (dest_lr ? (384 + VBSBS_Separation) : 0);
+   uint32 *target = surface->pixels + column + (dest_lr ? (384 + VBSBS_Separation) : 0);
    const int32 pitch32 = surface->pitch32;
-   const uint8 *fb_source = &FB[fb][lr][64 * Column];
+   const uint8 *fb_source = &FB[fb][lr][64 * column];
 
    if(DisplayActive_arg)
    {
@@ -1148,22 +1314,26 @@ static void CopyFBColumnToTarget_SideBySide_BASE(const bool DisplayActive_arg, c
    }
 }
 
-static void CopyFBColumnToTarget_SideBySide(void)
+static void CopyFBColumnsToTarget_SideBySide(const int lr, int32 column, int32 count)
 {
-   const int lr = (DisplayRegion & 2) >> 1;
-
    if(!lr)
-      CopyFBColumnToTarget_SideBySide_BASE(DisplayActive, 0, 0 ^ VB3DReverse);
+   {
+      for(; count > 0; count--, column++)
+         CopyFBColumnToTarget_SideBySide_BASE(DisplayActive, 0, 0 ^ VB3DReverse, column);
+   }
    else
-      CopyFBColumnToTarget_SideBySide_BASE(DisplayActive, 1, 1 ^ VB3DReverse);
+   {
+      for(; count > 0; count--, column++)
+         CopyFBColumnToTarget_SideBySide_BASE(DisplayActive, 1, 1 ^ VB3DReverse, column);
+   }
 }
 
-static INLINE void CopyFBColumnToTarget_VLI_BASE(const bool DisplayActive_arg, const int lr, const int dest_lr)
+static INLINE void CopyFBColumnToTarget_VLI_BASE(const bool DisplayActive_arg, const int lr, const int dest_lr, const int32 column)
 {
    const int fb           = DisplayFB;
-   uint32 *target         = surface->pixels + Column * 2 * VBPrescale + dest_lr;
+   uint32 *target         = surface->pixels + column * 2 * VBPrescale + dest_lr;
    const int32 pitch32    = surface->pitch32;
-   const uint8 *fb_source = &FB[fb][lr][64 * Column];
+   const uint8 *fb_source = &FB[fb][lr][64 * column];
 
    if(DisplayActive_arg)
    {
@@ -1207,24 +1377,28 @@ static INLINE void CopyFBColumnToTarget_VLI_BASE(const bool DisplayActive_arg, c
    }
 }
 
-static void CopyFBColumnToTarget_VLI(void)
+static void CopyFBColumnsToTarget_VLI(const int lr, int32 column, int32 count)
 {
-   const int lr = (DisplayRegion & 2) >> 1;
-
    if(!lr)
-      CopyFBColumnToTarget_VLI_BASE(DisplayActive, 0, 0 ^ VB3DReverse);
+   {
+      for(; count > 0; count--, column++)
+         CopyFBColumnToTarget_VLI_BASE(DisplayActive, 0, 0 ^ VB3DReverse, column);
+   }
    else
-      CopyFBColumnToTarget_VLI_BASE(DisplayActive, 1, 1 ^ VB3DReverse);
+   {
+      for(; count > 0; count--, column++)
+         CopyFBColumnToTarget_VLI_BASE(DisplayActive, 1, 1 ^ VB3DReverse, column);
+   }
 }
 
-static INLINE void CopyFBColumnToTarget_HLI_BASE(const bool DisplayActive_arg, const int lr, const int dest_lr)
+static INLINE void CopyFBColumnToTarget_HLI_BASE(const bool DisplayActive_arg, const int lr, const int dest_lr, const int32 column)
 {
    const int fb = DisplayFB;
    const int32 pitch32 = surface->pitch32;
-   uint32 *target = surface->pixels + Column + dest_lr * pitch32;
-   const uint8 *fb_source = &FB[fb][lr][64 * Column];
+   uint32 *target = surface->pixels + column + dest_lr * pitch32;
+   const uint8 *fb_source = &FB[fb][lr][64 * column];
 
-   if(VBPrescale <= 4)
+   if(VBPrescale <= 4 && HLILUT)
    {
       int y;
       for(y = 56; y; y--)
@@ -1273,14 +1447,89 @@ static INLINE void CopyFBColumnToTarget_HLI_BASE(const bool DisplayActive_arg, c
    }
 }
 
-static void CopyFBColumnToTarget_HLI(void)
+static void CopyFBColumnsToTarget_HLI(const int lr, int32 column, int32 count)
 {
-   const int lr = (DisplayRegion & 2) >> 1;
-
-   if (!lr)
-      CopyFBColumnToTarget_HLI_BASE(DisplayActive, 0, 0 ^ VB3DReverse);
+   if(!lr)
+   {
+      for(; count > 0; count--, column++)
+         CopyFBColumnToTarget_HLI_BASE(DisplayActive, 0, 0 ^ VB3DReverse, column);
+   }
    else
-      CopyFBColumnToTarget_HLI_BASE(DisplayActive, 1, 1 ^ VB3DReverse);
+   {
+      for(; count > 0; count--, column++)
+         CopyFBColumnToTarget_HLI_BASE(DisplayActive, 1, 1 ^ VB3DReverse, column);
+   }
+}
+
+static void BuildBrightRuns(void)
+{
+   int lr;
+   int cur_repeat = -1;
+
+   for(lr = 0; lr < 2; lr++)
+   {
+      const uint32 ct_base = 0x1DFFE - (lr ? 0 : 0x200);
+      BrightRun *run = BrightRuns[lr];
+      int32 start = 0;
+
+      while(start < 384)
+      {
+         const uint8 run_repeat = VIP_MA16R16(DRAM, ct_base - ((start >> 2) * 2)) >> 8;
+         int32 end = start + 4;
+
+         while(end < 384 && (uint8)(VIP_MA16R16(DRAM, ct_base - ((end >> 2) * 2)) >> 8) == run_repeat)
+            end += 4;
+
+         if(run_repeat != cur_repeat)
+         {
+            cur_repeat = run_repeat;
+            CalcBrightnessCache(run_repeat);
+         }
+
+         run->start  = start;
+         run->length = end - start;
+         run->repeat = run_repeat;
+         memcpy(run->bright, BrightnessCache, sizeof(run->bright));
+         memcpy(run->clut, BrightCLUT, sizeof(run->clut));
+
+         run++;
+         start = end;
+      }
+
+      BrightRunCount[lr] = run - BrightRuns[lr];
+   }
+
+   if(cur_repeat != Repeat)
+      CalcBrightnessCache(Repeat);
+   BrightRunsDirty = false;
+}
+
+/* Converts both eyes of the display framebuffer in one go, for use at
+ * frame start when InstantDisplayHack is set.  Each run of columns is
+ * handed to the copy function as a single block with its brightness
+ * tables loaded up front. */
+static void ConvertFrame(void)
+{
+   int lr;
+   unsigned i;
+
+   if(BrightRunsDirty)
+      BuildBrightRuns();
+
+   for(lr = 0; lr < 2; lr++)
+   {
+      for(i = 0; i < BrightRunCount[lr]; i++)
+      {
+         const BrightRun *run = &BrightRuns[lr][i];
+
+         memcpy(BrightnessCache, run->bright, sizeof(BrightnessCache));
+         memcpy(BrightCLUT, run->clut, sizeof(BrightCLUT));
+         CopyFBColumnsToTarget(lr, run->start, run->length);
+      }
+   }
+
+   if(BrightRuns[1][BrightRunCount[1] - 1].repeat != Repeat)
+      CalcBrightnessCache(Repeat);
 }
 
 v810_timestamp_t MDFN_FASTCALL VIP_Update(const v810_timestamp_t timestamp)
@@ -1306,7 +1555,10 @@ v810_timestamp_t MDFN_FASTCALL VIP_Update(const v810_timestamp_t timestamp)
          {
             MDFN_ALIGN(8) uint8 DrawingBuffers[2][512 * 8];	/* Don't decrease this from 512 unless you adjust vip_draw.inc(including areas that draw off-visible >= 384 and >= -7 for speed reasons) */
 
-            if(skip && InstantDisplayHack && AllowDrawSkip) { }
+            /* Only skip rasterisation when the game swaps framebuffers
+             * every frame; otherwise a block drawn now may still be
+             * on display during a later, non-skipped frame. */
+            if(skip && InstantDisplayHack && AllowDrawSkip && !FRMCYC) { }
             else
             {
                int lr;
@@ -1365,8 +1617,8 @@ v810_timestamp_t MDFN_FASTCALL VIP_Update(const v810_timestamp_t timestamp)
                   RecalcBrightnessCache();
                }
             }
-            if(!skip && !InstantDisplayHack)
-               CopyFBColumnToTarget();
+            if(!skip_convert && !InstantDisplayHack)
+               CopyFBColumnsToTarget((DisplayRegion & 2) >> 1, Column, 1);
          }
 
          ColumnCounter = 259;
@@ -1417,41 +1669,13 @@ v810_timestamp_t MDFN_FASTCALL VIP_Update(const v810_timestamp_t timestamp)
                   GameFrameCounter = 0;
                }
 
-               if(!skip && InstantDisplayHack)
-               {
-                  int lr;
-                  /* Ugly kludge, fix in the future. */
-                  int32 save_DisplayRegion = DisplayRegion;
-                  int32 save_Column = Column;
-                  uint8 save_Repeat = Repeat;
-
-                  for(lr = 0; lr < 2; lr++)
-                  {
-                     DisplayRegion = lr << 1;
-                     for(Column = 0; Column < 384; Column++)
-                     {
-                        if(!(Column & 3))
-                        {
-                           uint16 ctdata = VIP_MA16R16(DRAM, 0x1DFFE - ((Column >> 2) * 2) - (lr ? 0 : 0x200));
-
-                           if((ctdata >> 8) != Repeat)
-                           {
-                              Repeat = ctdata >> 8;
-                              RecalcBrightnessCache();
-                           }
-                        }
-
-                        CopyFBColumnToTarget();
-                     }
-                  }
-                  DisplayRegion = save_DisplayRegion;
-                  Column = save_Column;
-                  Repeat = save_Repeat;
-                  RecalcBrightnessCache();
-               }
+               if(!skip_convert && InstantDisplayHack)
+                  ConvertFrame();
 
                VB_ExitLoop();
             }
+            else	/* running_timestamp starts at 'timestamp', not last_ts */
+               VB_DisplayRegionBoundary(timestamp - clocks + chunk_clocks, DisplayRegion);
          }
       }
 
@@ -1463,11 +1687,16 @@ v810_timestamp_t MDFN_FASTCALL VIP_Update(const v810_timestamp_t timestamp)
    return (timestamp + ColumnCounter);
 }
 
+bool VIP_RedrawsFB(void)
+{
+   return (XPCTRL & XPCTRL_XP_EN) && !FRMCYC;
+}
+
 int VIP_StateAction(StateMem *sm, int load, int data_only)
 {
    SFORMAT StateRegs[] =
    {
-      SFARRAY(FB[0][0], 0x6000 * 2 * 2),
+      SFARRAY(FB[0][0], data_only ? 0 : 0x6000 * 2 * 2),	/* See VIP_RedrawsFB() */
       SFARRAY16(CHR_RAM, 0x8000 / sizeof(uint16)),
       SFARRAY16(DRAM, 0x20000 / sizeof(uint16)),
 
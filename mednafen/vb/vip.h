@@ -41,8 +41,12 @@ enum
 };
 
 bool VIP_Init(void) MDFN_COLD;
+void VIP_Kill(void) MDFN_COLD;
 void VIP_Power(void) MDFN_COLD;
 
+/* Bytes currently held by the VIP, including buffers allocated for the active 3D mode. */
+uint32 VIP_GetMemoryUsage(void);
+
 void VIP_SetInstantDisplayHack(bool);
 void VIP_SetAllowDrawSkip(bool);
 void VIP_Set3DMode(uint32 mode, bool reverse, uint32 prescale, uint32 sbs_separation);
@@ -63,6 +67,10 @@ void VIP_Write16(v810_timestamp_t timestamp, uint32 A, uint16 V);
 
 int VIP_StateAction(StateMem *sm, int load, int data_only);
 
+/* True while the VIP draws a whole framebuffer every frame (drawing enabled,
+ * FRMCYC 0).  Only then may a data_only state leave the framebuffers out. */
+bool VIP_RedrawsFB(void);
+
 uint32 VIP_GetRegister(const unsigned int id, char *special, const uint32 special_len);
 void VIP_SetRegister(const unsigned int id, const uint32 value);
 
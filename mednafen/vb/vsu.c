@@ -67,19 +67,40 @@ uint32 lfsr;
 int32 last_output[6][2];
 int32 last_ts;
 
-Blip_Buffer *bb_l;
-Blip_Buffer *bb_r;
+/* When set, channels are still stepped but no output is synthesized;
+ * last_output is left alone so unmuting resumes with the right deltas. */
+static bool SynthMuted;
+
+/* Register writes are logged with their timestamps and replayed in order
+ * at the end of the frame (or when the log fills), so a CPU-side write is
+ * just an append instead of a synchronous catch-up. */
+#define VSU_WRITE_LOG_SIZE 512
+
+typedef struct
+{
+   int32 timestamp;
+   uint16 A;
+   uint8 V;
+} VSU_LoggedWrite;
+
+static VSU_LoggedWrite WriteLog[VSU_WRITE_LOG_SIZE];
+static unsigned WriteLogCount;
+
+/* Caller timestamp at which the current audio slice began; VSU time
+ * (last_ts and logged writes) is relative to it. */
+static int32 SliceBase;
+
+Blip_StereoBuffer *sbuf;
 Blip_Synth Synth;
 Blip_Synth NoiseSynth;
 
 static const unsigned int Tap_LUT[8] = { 15 - 1, 11 - 1, 14 - 1, 5 - 1, 9 - 1, 7 - 1, 10 - 1, 12 - 1 };
 
-void VSU_Init(Blip_Buffer *_bb_l, Blip_Buffer *_bb_r)
+void VSU_Init(Blip_StereoBuffer *_sbuf)
 {
    unsigned ch, lr;
 
-   bb_l    = _bb_l;
-   bb_r    = _bb_r;
+   sbuf    = _sbuf;
 
    Blip_Synth_set_volume(&Synth, 1.0 / 6 / 2, 0x400);
 
@@ -130,17 +151,13 @@ void VSU_Power(void)
    memset(ModData, 0, sizeof(ModData));
 
    last_ts = 0;
+
+   WriteLogCount = 0;
+   SliceBase = 0;
 }
 
-void VSU_Write(int32 timestamp, uint32 A, uint8 V)
+static void VSU_ApplyWrite(uint32 A, uint8 V)
 {
-   if(MDFN_UNLIKELY(A & 0x3))
-      return;
-
-   A &= 0x7FF;
-
-   VSU_Update(timestamp);
-
    if(A < 0x280)
       WaveData[A >> 7][(A >> 2) & 0x1F] = V & 0x3F;
    else if(A < 0x400) /* Modulation mirror write? */
@@ -248,6 +265,38 @@ void VSU_Write(int32 timestamp, uint32 A, uint8 V)
    }
 }
 
+/* Replays the logged writes up to 'timestamp' (slice-relative).  Any
+ * later ones stay in the log. */
+static void VSU_ReplayWrites(int32 timestamp)
+{
+   unsigned i;
+
+   for(i = 0; i < WriteLogCount && WriteLog[i].timestamp <= timestamp; i++)
+   {
+      VSU_Update(WriteLog[i].timestamp);
+      VSU_ApplyWrite(WriteLog[i].A, WriteLog[i].V);
+   }
+
+   WriteLogCount -= i;
+   memmove(WriteLog, WriteLog + i, WriteLogCount * sizeof(WriteLog[0]));
+}
+
+void VSU_Write(int32 timestamp, uint32 A, uint8 V)
+{
+   VSU_LoggedWrite *w;
+
+   if(MDFN_UNLIKELY(A & 0x3))
+      return;
+
+   if(MDFN_UNLIKELY(WriteLogCount == VSU_WRITE_LOG_SIZE))
+      VSU_ReplayWrites(timestamp - SliceBase);
+
+   w = &WriteLog[WriteLogCount++];
+   w->timestamp = timestamp - SliceBase;
+   w->A = A & 0x7FF;
+   w->V = V;
+}
+
 static INLINE void VSU_CalcCurrentOutput(int ch, int *left, int *right)
 {
    int WD;
@@ -286,23 +335,78 @@ static INLINE void VSU_CalcCurrentOutput(int ch, int *left, int *right)
    *right = WD * r_ol;
 }
 
-void VSU_Update(int32 timestamp)
+/* Queues the channel's output change, if any, into sd.  Only deltas that
+ * actually change the output level are queued; a zero delta would leave the
+ * Blip_StereoBuffer untouched anyway. */
+static INLINE void VSU_QueueOutput(int ch, Blip_StereoDelta *sd)
 {
    int left, right;
+
+   VSU_CalcCurrentOutput(ch, &left, &right);
+
+   if(left != last_output[ch][0] || right != last_output[ch][1])
+   {
+      Blip_StereoDelta_add(&Synth, sd, left - last_output[ch][0], right - last_output[ch][1]);
+      last_output[ch][0] = left;
+      last_output[ch][1] = right;
+   }
+}
+
+/* True if the channel's output is (and stays, until the next effects clock
+ * tick or register write) zero, whatever its wave position. */
+static INLINE bool VSU_OutputIsSilent(int ch)
+{
+   if(!(IntlControl[ch] & 0x80) || !Envelope[ch])
+      return true;
+
+   if(!LeftLevel[ch] && !RightLevel[ch])
+      return true;
+
+   return ch != 5 && RAMAddress[ch] > 4;
+}
+
+/* True if every channel is disabled and its last output was zero, in which
+ * case an update has nothing to step and nothing to emit. */
+static INLINE bool VSU_AllSilent(void)
+{
    unsigned ch;
 
+   for(ch = 0; ch < 6; ch++)
+   {
+      if((IntlControl[ch] & 0x80) || last_output[ch][0] || last_output[ch][1])
+         return false;
+   }
+
+   return true;
+}
+
+void VSU_Update(int32 timestamp)
+{
+   Blip_StereoDelta sd;
+   unsigned ch;
+
+   if(VSU_AllSilent())
+   {
+      last_ts = timestamp;
+      return;
+   }
+
+   Blip_StereoDelta_clear(&sd);
+
+   /* Output sound here; changes from all channels at the start of the
+    * update share a timestamp and go in as one impulse per side. */
+   if(!SynthMuted)
+   {
+      for(ch = 0; ch < 6; ch++)
+         VSU_QueueOutput(ch, &sd);
+      Blip_StereoDelta_flush(&sd, last_ts, sbuf);
+   }
+
    for(ch = 0; ch < 6; ch++)
    {
       int32 clocks = timestamp - last_ts;
       int32 running_timestamp = last_ts;
 
-      /* Output sound here */
-      VSU_CalcCurrentOutput(ch, &left, &right);
-      Blip_Synth_offset(&Synth, running_timestamp, left - last_output[ch][0], bb_l);
-      Blip_Synth_offset(&Synth, running_timestamp, right - last_output[ch][1], bb_r);
-      last_output[ch][0] = left;
-      last_output[ch][1] = right;
-
       if(!(IntlControl[ch] & 0x80))
          continue;
 
@@ -313,12 +417,16 @@ void VSU_Update(int32 timestamp)
          if(chunk_clocks > EffectsClockDivider[ch])
             chunk_clocks = EffectsClockDivider[ch];
 
+         /* While a wave channel is silent, nothing but the effects clock
+          * can change its output, so step straight to it. The noise
+          * channel still has to be walked latch by latch to keep the
+          * LFSR/NoiseLatcher sequence exact. */
          if(ch == 5)
          {
             if(chunk_clocks > NoiseLatcherClockDivider)
                chunk_clocks = NoiseLatcherClockDivider;
          }
-         else
+         else if(!SynthMuted && !VSU_OutputIsSilent(ch))
          {
             if(EffFreq[ch] >= 2040)
             {
@@ -333,25 +441,28 @@ void VSU_Update(int32 timestamp)
          }
 
          FreqCounter[ch] -= chunk_clocks;
-         while(FreqCounter[ch] <= 0)
+         if(ch == 5)
          {
-            if(ch == 5)
+            while(FreqCounter[ch] <= 0)
             {
                int feedback = ((lfsr >> 7) & 1) ^ ((lfsr >> Tap_LUT[(EnvControl[5] >> 12) & 0x7]) & 1) ^ 1;
                lfsr = ((lfsr << 1) & 0x7FFF) | feedback;
 
                FreqCounter[ch] += 10 * (2048 - EffFreq[ch]);
             }
-            else
-            {
-               FreqCounter[ch] += 2048 - EffFreq[ch];
-               WavePos[ch] = (WavePos[ch] + 1) & 0x1F;
-            }
+         }
+         else if(FreqCounter[ch] <= 0)
+         {
+            const int32 period = 2048 - EffFreq[ch];
+            const int32 steps = (-FreqCounter[ch]) / period + 1;
+
+            FreqCounter[ch] += steps * period;
+            WavePos[ch] = (WavePos[ch] + steps) & 0x1F;
          }
 
          LatcherClockDivider[ch] -= chunk_clocks;
-         while(LatcherClockDivider[ch] <= 0)
-            LatcherClockDivider[ch] += 120;
+         if(LatcherClockDivider[ch] <= 0)
+            LatcherClockDivider[ch] += 120 * ((-LatcherClockDivider[ch]) / 120 + 1);
 
          if(ch == 5)
          {
@@ -457,21 +568,47 @@ void VSU_Update(int32 timestamp)
          running_timestamp += chunk_clocks;
 
          /* Output sound here too. */
-         VSU_CalcCurrentOutput(ch, &left, &right);
-         Blip_Synth_offset(&Synth, running_timestamp, left - last_output[ch][0], bb_l);
-         Blip_Synth_offset(&Synth, running_timestamp, right - last_output[ch][1], bb_r);
-         last_output[ch][0] = left;
-         last_output[ch][1] = right;
+         if(!SynthMuted)
+         {
+            VSU_QueueOutput(ch, &sd);
+            Blip_StereoDelta_flush(&sd, running_timestamp, sbuf);
+         }
       }
    }
 
    last_ts = timestamp;
 }
 
-void VSU_EndFrame(int32 timestamp)
+void VSU_SetSynthMuted(bool muted)
+{
+   SynthMuted = muted;
+}
+
+int32 VSU_EndSlice(int32 timestamp)
 {
-   VSU_Update(timestamp);
+   int32 clocks = timestamp - SliceBase;
+   unsigned i;
+
+   /* A slice can end behind writes already logged, when the VIP catches
+    * up across a display region boundary; those move to the next slice. */
+   VSU_ReplayWrites(clocks);
+   VSU_Update(clocks);
    last_ts = 0;
+   SliceBase = timestamp;
+
+   for(i = 0; i < WriteLogCount; i++)
+      WriteLog[i].timestamp -= clocks;
+
+   return clocks;
+}
+
+int32 VSU_EndFrame(int32 timestamp)
+{
+   int32 clocks = VSU_EndSlice(timestamp);
+
+   SliceBase = 0;
+
+   return clocks;
 }
 
 int VSU_StateAction(StateMem *sm, int load, int data_only)
@@ -516,6 +653,14 @@ int VSU_StateAction(StateMem *sm, int load, int data_only)
       SFEND
    };
 
+   /* States are taken between frames, after VSU_EndFrame() has drained
+    * the write log; anything still logged on load belongs to the old state. */
+   if(load)
+   {
+      WriteLogCount = 0;
+      SliceBase = 0;
+   }
+
    return MDFNSS_StateAction(sm, load, data_only, StateRegs, "VSU", false);
 }
 
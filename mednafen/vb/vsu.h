@@ -9,13 +9,21 @@
 extern "C" {
 #endif
 
-void VSU_Init(Blip_Buffer *bb_l, Blip_Buffer *bb_r) MDFN_COLD;
+void VSU_Init(Blip_StereoBuffer *sbuf) MDFN_COLD;
 
 void VSU_Power(void) MDFN_COLD;
 
 void VSU_Write(int32 timestamp, uint32 A, uint8 V);
 
-void VSU_EndFrame(int32 timestamp);
+/* Both return the clocks elapsed since the previous slice or frame end;
+ * that is the length to pass to Blip_StereoBuffer_end_frame().  A slice
+ * lets samples be read out mid-frame without disturbing the output. */
+int32 VSU_EndSlice(int32 timestamp);
+int32 VSU_EndFrame(int32 timestamp);
+
+/* Skip synthesis while keeping channel state emulated, e.g. when the
+ * frontend fast-forwards.  The Blip_StereoBuffer must not be advanced while muted. */
+void VSU_SetSynthMuted(bool muted);
 
 int VSU_StateAction(StateMem *sm, int load, int data_only);
 
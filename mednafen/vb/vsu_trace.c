@@ -0,0 +1,192 @@
+/* Mednafen - Multi-system Emulator
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+/* Standalone VSU regression check and benchmark, not part of the core.
+ * Built and run with `make vsu-check` and `make vsu-bench`.
+ *
+ * It renders fixed, pseudo-random register-write traces through the VSU
+ * and Blip_StereoBuffer at 44100 Hz and hashes the PCM.  REFERENCE_HASH
+ * is the output of the original per-channel VSU (two Blip_Buffers, one
+ * Blip_Synth_offset() per side and channel) for the check trace, so any
+ * change to synthesis or mixing that is meant to be exact has to keep it.
+ *
+ * `vsu_trace bench [frames]` times the same writes with more or less of
+ * each 500 frames left silent, from none to most of them. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "../mednafen-types.h"
+#include "vsu.h"
+
+#define TRACE_FRAMES       3000
+#define TRACE_PERIOD       500
+#define TRACE_CHECK_ACTIVE 200
+#define TRACE_FRAME_CLOCKS 100000	/* VSU clocks (5 MHz) per 50 Hz frame */
+
+#define REFERENCE_HASH     0xddd250d61b150b36ULL
+
+/* The trace never saves state. */
+int MDFNSS_StateAction(void *st, int load, int data_only, SFORMAT *sf, const char *name, bool optional)
+{
+   return 1;
+}
+
+static Blip_StereoBuffer sbuf;
+static int16 pcm[0x8000 * 2];
+
+static uint32 rng;
+
+static uint32 Rand(void)
+{
+   rng ^= rng << 13;
+   rng ^= rng >> 17;
+   rng ^= rng << 5;
+
+   return rng;
+}
+
+static uint64 HashPCM(uint64 h, const int16 *p, long count)
+{
+   long i;
+
+   for(i = 0; i < count; i++)
+   {
+      h = (h ^ (uint8)p[i]) * 1099511628211ULL;
+      h = (h ^ (uint8)((uint16)p[i] >> 8)) * 1099511628211ULL;
+   }
+
+   return h;
+}
+
+/* Waveform and modulation RAM, then frames of music-like register writes:
+ * key-ons, levels, frequencies, envelopes, waveform selects and sweep /
+ * modulation control, spread over the frame.  After the first 'active'
+ * frames of every TRACE_PERIOD the channels are stopped, and stay silent
+ * for the rest of it. */
+static void TraceFrame(unsigned frame, unsigned active)
+{
+   int32 ts = 0;
+   unsigned w;
+
+   if(frame % TRACE_PERIOD == active)
+      VSU_Write(10, 0x580, 1);
+
+   if(frame % TRACE_PERIOD >= active)
+      return;
+
+   for(w = 0; w < 24; w++)
+   {
+      uint32 x    = Rand();
+      uint32 base = 0x400 + (x % 6) * 0x40;
+
+      ts += TRACE_FRAME_CLOCKS / 25;
+
+      switch((x >> 4) & 7)
+      {
+         case 0: VSU_Write(ts, base + 0x00, 0x80 | ((x >> 8) & 0x3F)); break;
+         case 1: VSU_Write(ts, base + 0x04, x >> 8); break;
+         case 2: VSU_Write(ts, base + 0x08, x >> 8);
+                 VSU_Write(ts, base + 0x0C, x >> 16); break;
+         case 3: VSU_Write(ts, base + 0x10, x >> 8); break;
+         case 4: VSU_Write(ts, base + 0x14, x >> 8); break;
+         case 5: VSU_Write(ts, base + 0x18, (x >> 8) & 0x7); break;
+         case 6: VSU_Write(ts, 0x51C, x >> 8); break;
+         default: break;
+      }
+   }
+}
+
+static uint64 RenderTrace(unsigned frames, unsigned active)
+{
+   uint64 h = 14695981039346656037ULL;
+   unsigned frame;
+   uint32 a;
+
+   rng = 0x1234567;
+
+   Blip_StereoBuffer_init(&sbuf);
+   Blip_StereoBuffer_set_sample_rate(&sbuf, 44100, 50);
+   Blip_StereoBuffer_set_clock_rate(&sbuf, 20000000 / 4);
+   Blip_StereoBuffer_bass_freq(&sbuf, 20);
+
+   VSU_Init(&sbuf);
+   VSU_Power();
+
+   for(a = 0; a < 0x300; a += 4)
+      VSU_Write(0, a, Rand());
+
+   for(frame = 0; frame < frames; frame++)
+   {
+      long count;
+
+      TraceFrame(frame, active);
+
+      Blip_StereoBuffer_end_frame(&sbuf, VSU_EndFrame(TRACE_FRAME_CLOCKS));
+      count = Blip_StereoBuffer_read_samples(&sbuf, pcm, 0x8000);
+      h = HashPCM(h, pcm, count * 2);
+   }
+
+   Blip_StereoBuffer_deinit(&sbuf);
+
+   return h;
+}
+
+static void Bench(unsigned frames)
+{
+   static const unsigned active[] = { TRACE_PERIOD, TRACE_CHECK_ACTIVE, 50 };
+   unsigned i;
+
+   for(i = 0; i < sizeof(active) / sizeof(active[0]); i++)
+   {
+      clock_t start = clock();
+      uint64 h      = RenderTrace(frames, active[i]);
+      double secs   = (double)(clock() - start) / CLOCKS_PER_SEC;
+
+      printf("%3u%% silent: %u frames in %.3f s, %.2f us per frame (hash %016llx)\n",
+            100 - active[i] * 100 / TRACE_PERIOD, frames, secs,
+            secs * 1000000.0 / frames, (unsigned long long)h);
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   uint64 h;
+
+   if(argc > 1 && !strcmp(argv[1], "bench"))
+   {
+      Bench(argc > 2 ? strtoul(argv[2], NULL, 10) : 20000);
+      return 0;
+   }
+
+   h = RenderTrace(TRACE_FRAMES, TRACE_CHECK_ACTIVE);
+
+   printf("VSU trace PCM hash: %016llx (reference %016llx)\n",
+         (unsigned long long)h, (unsigned long long)REFERENCE_HASH);
+
+   if(h != REFERENCE_HASH)
+   {
+      printf("FAILED: VSU output differs from the reference.\n");
+      return 1;
+   }
+
+   printf("OK\n");
+
+   return 0;
+}